@@ -0,0 +1,43 @@
+#ifndef _TONES_ACCURACY_H_
+#define _TONES_ACCURACY_H_
+
+namespace tones {
+namespace accuracy {
+
+/**
+ * @brief Policies of accuracy, chosen at compile time
+ *
+ * Given to the run() of the CPU and the PPU, and to System,
+ * so that each variant is built on its own, with the checks
+ * of the other one folded away
+ */
+
+/**
+ * @brief Frame-level correctness, at full speed
+ *
+ * The CPU runs each instruction at once, on its first tick,
+ * with the cycles of the operation set. The PPU passes the
+ * dots nothing happens on in batches
+ */
+struct Fast {
+    static const bool CountsCycles = false;
+};
+
+/**
+ * @brief Cycle counts and bus accesses of the 6502
+ *
+ * The CPU also does the dummy reads and writes of the 6502,
+ * and takes the extra cycles of page crossing and branches,
+ * so each instruction lasts as many ticks as on the chip.
+ * Its accesses all still happen on its first tick, though,
+ * not each on its own cycle. The PPU runs every dot on its
+ * own
+ */
+struct CycleCounted {
+    static const bool CountsCycles = true;
+};
+
+} // namespace accuracy
+} // namespace tones
+
+#endif // _TONES_ACCURACY_H_
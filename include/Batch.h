@@ -0,0 +1,162 @@
+#ifndef _TONES_BATCH_H_
+#define _TONES_BATCH_H_
+
+#include <cinttypes>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Bus.h"
+#include "Cartridge.h"
+#include "MicroProcessor.h"
+
+namespace tones {
+namespace cpu {
+
+/**
+ * @brief RAM of all the instances of a batch, interleaved
+ *
+ * The bytes of one address of all the instances are in a row,
+ * so that an access of the same address by all the lanes is
+ * one contiguous vector. Seen from the bus, it is the RAM of
+ * the instance of the current lane only
+ */
+class LaneMemory final : public Accessible
+{
+
+public:
+
+    LaneMemory(int lanes);
+
+    bool contains(uint16_t addr) const override;
+
+    void read(uint16_t address, uint8_t &buffer) const override;
+
+    void write(uint16_t address, uint8_t data) override;
+
+    //! Instance accessed through the bus
+    void setLane(int lane);
+
+    //! Bytes of an address for all the lanes
+    inline uint8_t *lanes(uint16_t address);
+
+private:
+
+    const int _lanes;
+
+    int _lane;
+
+    std::vector<uint8_t> _memory;
+};
+
+/**
+ * @brief Instances of one program run side by side
+ *
+ * The registers of the instances are kept as arrays, one
+ * entry a lane. Each round runs one instruction on every
+ * lane: the lanes at the same PC are run together, by loops
+ * over the arrays masked by the lanes in the group, which
+ * the compiler turns into SIMD code. On x86-64 Linux they
+ * are built for both SSE2 and AVX2, the AVX2 ones picked
+ * when loaded on a host that has it. The op code and its
+ * operands are decoded once for all of them, from the
+ * shared PRG-ROM, by OperationSet
+ *
+ * Lanes alone at their PC, or at an instruction not done by
+ * the lanes, like the stack ones and the indexed modes, run
+ * one by one on a CPU of the switch core, with their state
+ * loaded. They join the others again once at the same PC
+ *
+ * Only the CPU, the RAM and the PRG-ROM are emulated, for
+ * searches on the logic of a program with varied inputs
+ *
+ * Experimental, see occupancy() for whether it pays off
+ */
+class Batch
+{
+
+public:
+
+    typedef struct Occupancy {
+        uint64_t vectorSteps; // instructions run for groups of lanes
+        uint64_t vectorLanes; // lanes in these groups
+        uint64_t scalarSteps; // instructions run for lanes one by one
+    } Occupancy_t;
+
+public:
+
+    Batch(int lanes);
+
+    //! Insert a cartridge file, of mapper 0 only
+    bool insert(const std::string &path);
+
+    //! Reset all the lanes, with their RAM cleared
+    void reset();
+
+    //! Set the register PC of all the lanes
+    void jump(uint16_t address);
+
+    //! Write into the RAM of one lane, like its input
+    void write(int lane, uint16_t address, uint8_t data);
+
+    uint8_t read(int lane, uint16_t address);
+
+    //! Run one instruction on every lane, for a number of rounds
+    void run(uint64_t rounds);
+
+    int lanes() const;
+
+    void dump(int lane, MicroProcessor::Registers_t &registers) const;
+
+    //! Tick of the next instruction of a lane, since reset
+    uint64_t ticks(int lane) const;
+
+    const Occupancy_t &occupancy() const;
+
+    //! Print the share of the instructions run in groups, and their sizes
+    void report(std::ostream &out) const;
+
+private:
+
+    //! Run one instruction on the lanes of the mask, at the same PC, false if not done by the lanes
+    bool vector(const uint8_t *mask, uint16_t pc);
+
+    //! Run one instruction on one lane, with the scalar CPU
+    void scalar(int lane);
+
+    //! Read the operand of each lane, false unless it is in RAM or ROM
+    bool load(code::AddressingKind_t mode, uint16_t address);
+
+    //! The bytes of an operand in RAM of all the lanes, or nullptr
+    uint8_t *target(code::AddressingKind_t mode, uint16_t address);
+
+private:
+
+    const int _lanes;
+
+    /* Registers, one entry a lane */
+    std::vector<uint16_t> _reg_PC;
+    std::vector<uint8_t> _reg_A, _reg_X, _reg_Y, _reg_S, _reg_P;
+    std::vector<uint8_t> _flag_N, _flag_Z, _flag_C, _flag_V; // as Flags_t
+    std::vector<uint64_t> _ticks;
+
+    /* Lanes of a round, 0xff or 0 */
+    std::vector<uint8_t> _pending; // yet to run the round
+    std::vector<uint8_t> _mask;    // in the group being run
+
+    //! Operand read by each lane of the group
+    std::vector<uint8_t> _operand;
+
+    /* The scalar CPU, on the RAM of one lane */
+    Bus _mbus, _vbus;
+    LaneMemory _ram;
+    MicroProcessor _cpu;
+    CartridgePtr _card;
+
+    Occupancy_t _occupancy;
+};
+
+} // namespace cpu
+} // namespace tones
+
+#endif // _TONES_BATCH_H_
@@ -2,15 +2,56 @@
 #ifndef _TONES_BUS_H_
 #define _TONES_BUS_H_
 
+#include <array>
 #include <cinttypes>
+#include <functional>
 #include <vector>
 
+#ifdef TONES_BUS_TRACE
+#include "Trace.h"
+#endif
+
 namespace tones {
 
 class Bus;
+class Accessible;
 
 const int AddressSpace = 0x10000;
 
+/* Pages of the address space */
+const int PageShift = 8;
+const int PageSize  = 0x0100; // 256
+const int PageMask  = 0x00ff;
+const int PageCount = AddressSpace >> PageShift;
+
+/* Kinds of bus accesses */
+enum class Access {
+    Read  = 0x01,
+    Write = 0x02,
+};
+
+//! Called on an access to a watched address
+typedef std::function<void(uint16_t address, uint8_t data, Access access)> Watcher;
+
+/**
+ * @brief Entry of the page table
+ *
+ * A page backed by host memory is read and written directly
+ * at its base, with the address masked by the mirror mask,
+ * while other pages go through the owner device
+ *
+ * A page with watchpoints drops its host memory for the
+ * watched kinds of accesses, so that only these accesses
+ * take the path checking the watched addresses
+ */
+typedef struct Page {
+    Accessible *device;   // device owning the whole page, or nullptr
+    const uint8_t *rbase; // host memory to read from, or nullptr
+    uint8_t *wbase;       // host memory to write to, or nullptr
+    uint16_t mask;        // mirror mask of the host memory
+    uint8_t watch;        // kinds of accesses watched in the page
+} Page_t;
+
 /**
  * @brief Abstraction of an device
  * 
@@ -22,6 +63,8 @@ class Accessible
 
 public:
 
+    Accessible();
+
     virtual void attach(Bus &bus);
 
     virtual void detach();
@@ -32,13 +75,45 @@ public:
 
     virtual void write(uint16_t address, uint8_t data) = 0;
 
+    /** Read without side effects, for debugging
+     *
+     * Same as read() by default, MMIO devices return their
+     * latched values instead of triggering actions
+     */
+    virtual void peek(uint16_t address, uint8_t &buffer) const;
+
+    /** Whether reading an address again returns the same
+     *
+     * Only if nothing but the device itself changes it, and a
+     * read right after a read changes nothing more, like the
+     * status of MMIO devices. False by default
+     */
+    virtual bool stable(uint16_t address) const;
+
+    /** Write a block of data to one address in a row
+     *
+     * As a DMA unit feeds a port, which is a loop of write()
+     * by default, for devices to take the whole block at once
+     */
+    virtual void transfer(uint16_t address, const uint8_t *data, int length);
+
+    /** Map a page to the memory behind the device
+     *
+     * Plain memories fill in the host memory of the page, so
+     * that the bus can access it without calling read() and
+     * write(), while MMIO devices leave it as it is
+     *
+     * @param address base address of the page
+     * @param page entry of the page table
+     */
+    virtual void map(uint16_t address, Page_t &page);
+
 protected:
 
     friend class Bus;
 
-    virtual void read(uint8_t &buffer) const;
-
-    virtual void write(uint8_t data);
+    //! Map the pages of the device again, once its memory is moved
+    void remap();
 
     Bus *_bus;
 };
@@ -48,38 +123,166 @@ protected:
  * 
  * This class inclues the Address Bus, Control Bus and
  * Data Bus, actually
+ *
+ * The address space is split into pages, and the owner of
+ * each page is resolved when a device is mounted, so that
+ * an access just looks up the page table, rather than asks
+ * every device one by one
  */
 class Bus
 {
 
 public:
 
-    //! Abstraction of the Address Bus
+    Bus();
+
+    //! Abstraction of the Address Bus, latched by accesses to devices only
     uint16_t address() const;
 
     //! Abstraction of the Data Bus, with Control Bus of read mode
-    void read(uint16_t address, uint8_t &buffer);
+    inline void read(uint16_t address, uint8_t &buffer);
 
     //! Abstraction of the Data Bus, with Control Bus of write mode
-    void write(uint16_t address, uint8_t data);
+    inline void write(uint16_t address, uint8_t data);
+
+    //! Read one byte without side effects, for debugging
+    void peek(uint16_t address, uint8_t &buffer) const;
+
+    //! Whether reading an address again returns the same, see Accessible::stable()
+    bool stable(uint16_t address) const;
+
+    //! Copy a range of the address space without side effects
+    void dump(uint16_t address, uint8_t *buffer, int length) const;
+
+    //! Write a block of data to one address in a row
+    void transfer(uint16_t address, const uint8_t *data, int length);
+
+    //! Host memory from an address to the end of its page, nullptr if its reads are watched or traced
+    const uint8_t *memory(uint16_t address) const;
+
+    //! Entry of the page table of an address, kept up to date by the bus
+    inline const Page_t &page(uint16_t address) const;
+
+    //! Count of changes of the page table, to invalidate what is built on it
+    inline uint32_t generation() const;
+
+    /* Watchpoints */
+
+    //! Call the watcher on a kind of accesses to an address
+    void watch(uint16_t address, Access access);
+
+    //! Remove a watchpoint
+    void unwatch(uint16_t address, Access access);
+
+    //! Remove all the watchpoints
+    void unwatch();
+
+    void setWatcher(Watcher watcher);
+
+#ifdef TONES_BUS_TRACE
+    //! Record every access into a ring buffer, or stop with nullptr
+    void setTracer(trace::RingBuffer *tracer, uint8_t bus);
+#endif
 
 protected:
 
     friend class Accessible;
 
-    //! Mount a device
-    void attach(Accessible *device);
+    //! Mount a device, fails if it overlaps the mounted ones
+    bool attach(Accessible *device);
 
     //! Unmount a device
     void detach(Accessible *device);
 
+    //! Rebuild the page table
+    void remap();
+
+    //! Refresh the pages owned by a device
+    void remap(Accessible *device);
+
+    //! Fill in an entry of the page table
+    void map(int page, Accessible *device);
+
+    //! Read from the device of a page without host memory
+    void readDevice(uint16_t address, uint8_t &buffer);
+
+    //! Write to the device of a page without host memory
+    void writeDevice(uint16_t address, uint8_t data);
+
+    //! Find the device of an address in a shared page
+    Accessible *decode(uint16_t address) const;
+
+    //! Count the addresses of a page a device contains
+    static int coverage(const Accessible *device, int page);
+
+    //! Call the watcher if the address is watched
+    void watched(uint16_t address, uint8_t data, Access access);
+
 private:
 
     uint16_t _address;
 
+    uint32_t _generation;
+
     std::vector<Accessible*> _devices;
+
+    std::array<Page_t, PageCount> _pages;
+
+    //! Devices owning parts of the page
+    std::array<std::vector<Accessible*>, PageCount> _shared;
+
+    //! Kinds of accesses watched for each address
+    std::vector<uint8_t> _watches;
+
+    Watcher _watcher;
+
+#ifdef TONES_BUS_TRACE
+    trace::RingBuffer *_tracer;
+
+    uint8_t _traceId;
+#endif
 };
 
+inline const Page_t &Bus::page(uint16_t address) const
+{
+    return _pages[address >> PageShift];
+}
+
+inline uint32_t Bus::generation() const
+{
+    return _generation;
+}
+
+inline void Bus::read(uint16_t address, uint8_t &buffer)
+{
+    const Page_t &page = _pages[address >> PageShift];
+    if (page.rbase) {
+        buffer = page.rbase[address & page.mask];
+    } else {
+        readDevice(address, buffer);
+    }
+
+#ifdef TONES_BUS_TRACE
+    if (_tracer)
+        _tracer->record(_traceId, address, buffer, static_cast<uint8_t>(Access::Read));
+#endif
+}
+
+inline void Bus::write(uint16_t address, uint8_t data)
+{
+    const Page_t &page = _pages[address >> PageShift];
+    if (page.wbase) {
+        page.wbase[address & page.mask] = data;
+    } else {
+        writeDevice(address, data);
+    }
+
+#ifdef TONES_BUS_TRACE
+    if (_tracer)
+        _tracer->record(_traceId, address, data, static_cast<uint8_t>(Access::Write));
+#endif
+}
+
 } // namespace tones
 
 #endif // _TONES_BUS_H_
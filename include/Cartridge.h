@@ -29,6 +29,9 @@ public:
 
     virtual int mapper() const = 0;
 
+    //! Get the name table mirroring
+    virtual Mirroring_t mirroring() const = 0;
+
     //! Get the content of PRG-ROM
     virtual const std::vector<uint8_t> &prgRom() const;
 
@@ -73,6 +76,8 @@ public:
 
     int mapper() const override;
 
+    Mirroring_t mirroring() const override;
+
 protected:
 
     bool validate(const Header &header);
@@ -108,6 +113,18 @@ public:
     //! Get the content of CHR-ROM
     const std::vector<uint8_t> &chrRom() const;
 
+    //! Get the name table mirroring
+    Mirroring_t mirroring() const;
+
+    //! Get the number of the memory mapper
+    int mapper() const;
+
+    //! Apply a cheat to PRG-ROM
+    void patch(const Cheat_t &cheat);
+
+    //! Remove all the cheats
+    void unpatch();
+
 protected:
 
     Cartridge();
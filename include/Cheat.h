@@ -0,0 +1,43 @@
+#ifndef _TONES_CHEAT_H_
+#define _TONES_CHEAT_H_
+
+#include <cinttypes>
+#include <string>
+
+namespace tones {
+
+/**
+ * @brief A patch of one byte of PRG-ROM
+ *
+ * With a compare value, the byte is patched only when the
+ * bank mapped at the address holds that value
+ */
+typedef struct Cheat {
+    uint16_t address;
+    uint8_t  value;
+    uint8_t  compare;
+    bool     compared; // whether compare is used
+} Cheat_t;
+
+namespace cheat {
+
+/** Decode a Game Genie code of 6 or 8 letters
+ *
+ * The letters are APZLGITYEOXUKSVN, case insensitive
+ */
+bool decodeGameGenie(const std::string &code, Cheat_t &cheat);
+
+/** Decode a raw code, in hex
+ *
+ * AAAA:VV patches address AAAA with value VV, while
+ * AAAA?CC:VV only when the byte at AAAA is CC
+ */
+bool decodeRaw(const std::string &code, Cheat_t &cheat);
+
+//! Decode a Game Genie code, or a raw one
+bool decode(const std::string &code, Cheat_t &cheat);
+
+} // namespace cheat
+} // namespace tones
+
+#endif // _TONES_CHEAT_H_
@@ -39,9 +39,11 @@
 
 #include <cinttypes>
 #include <array>
+#include <map>
 #include <vector>
 
 #include "Bus.h"
+#include "Cheat.h"
 
 namespace tones {
 
@@ -62,12 +64,17 @@ public:
     static const int RamLowerBound = 0x0000;
     static const int RamUpperBound = 0x2000;
 
+    //! Cleared at power on, for runs to be repeatable
+    RandomAccessMemory();
+
     bool contains(uint16_t addr) const override;
 
     void read(uint16_t address, uint8_t &buffer) const override;
 
     void write(uint16_t address, uint8_t data) override;
 
+    void map(uint16_t address, Page_t &page) override;
+
 private:
 
     std::array<uint8_t, RamSize> _memory;
@@ -94,6 +101,8 @@ public:
 
     void write(uint16_t address, uint8_t data) override;
 
+    void map(uint16_t address, Page_t &page) override;
+
 private:
 
     std::array<uint8_t, SramSize> _memory;
@@ -103,6 +112,9 @@ private:
  * @brief ROM
  * 
  * PRG-ROM of CPU
+ *
+ * Cheats patch copies of the pages they are in, mapped in
+ * place of the PRG data, so the other pages are unchanged
  */
 class ReadOnlyMemory: public Accessible
 {
@@ -114,6 +126,7 @@ public:
     static const int RomBankCount = 2;
     static const int RomLowerBankBase = 0x8000;
     static const int RomUpperBankBase = 0xC000;
+    static const int RomPageCount = (RomMask + 1) >> PageShift;
 
     ReadOnlyMemory(const std::vector<uint8_t> &memory);
 
@@ -123,9 +136,28 @@ public:
 
     void write(uint16_t address, uint8_t data) override;
 
+    void map(uint16_t address, Page_t &page) override;
+
+    //! Apply a cheat, checked against the bank each time it is mapped
+    void patch(const Cheat_t &cheat);
+
+    //! Remove all the cheats
+    void unpatch();
+
 private:
 
+    //! Copy of a page with cheats applied
+    typedef struct Overlay {
+        std::array<uint8_t, PageSize> memory;
+        std::vector<Cheat_t> cheats;
+    } Overlay_t;
+
     const std::vector<uint8_t> &_memory;
+
+    //! Memory mapped at each page, the PRG data or an overlay
+    std::array<const uint8_t*, RomPageCount> _pages;
+
+    std::map<int, Overlay_t> _overlays;
 };
 
 /* For PPU MMIO Registers */
@@ -134,10 +166,28 @@ const int PpuMmioUpperBound  = 0x4000;
 
 /* Devices of PPU */
 
+/**
+ * @brief Name Table Mirroring
+ *
+ * How the four name tables in PPU addressing space are
+ * mapped to the 2KB VRAM, decided by the cartridge
+ */
+typedef enum class Mirroring {
+    Horizontal,  // $2000 = $2400, $2800 = $2C00
+    Vertical,    // $2000 = $2800, $2400 = $2C00
+    SingleLower, // all to the first 1KB
+    SingleUpper, // all to the second 1KB
+    FourScreen,  // 2KB more RAM on the cartridge
+} Mirroring_t;
+
 /**
  * @brief VRAM
  * 
  * Memory of PPU, or so called Name Tables
+ *
+ * Each 1KB name table is a slot pointing to its memory,
+ * so mirroring is resolved once when it is set, rather
+ * than masked on every access
  */
 class VideoRandomAccessMemory : public Accessible
 {
@@ -149,21 +199,38 @@ public:
     static const int VramLowerBound = 0x2000;
     static const int VramUpperBound = 0x3f00;
 
+    static const int TableCount = 4;
+    static const int TableSize  = 0x0400; // 1KB
+    static const int TableMask  = 0x03ff;
+    static const int TableShift = 10;
+
+    VideoRandomAccessMemory();
+
     bool contains(uint16_t addr) const override;
 
     void read(uint16_t address, uint8_t &buffer) const override;
 
     void write(uint16_t address, uint8_t data) override;
 
+    void map(uint16_t address, Page_t &page) override;
+
+    void setMirroring(Mirroring_t mirroring);
+
 private:
 
-    std::array<uint8_t, VramSize> _memory;
+    //! Name table slot of an address
+    inline int slot(uint16_t address) const;
+
+    std::array<uint8_t, TableCount * TableSize> _memory; // 2KB for four-screen
+
+    std::array<uint8_t*, TableCount> _tables;
 };
 
 /**
  * @brief PPU Pattern Tables
  * 
- * Mapped by a CHR-ROM or CHR-RAM of a cartridge
+ * Mapped by a CHR-ROM or CHR-RAM of a cartridge, in 1KB
+ * slots pointing to the CHR data, for mappers to switch
  */
 class PatternTables: public Accessible
 {
@@ -176,6 +243,11 @@ public:
     static const int TableLowerBankBase = 0x0000;
     static const int TableUpperBankBase = 0x1000;
 
+    static const int SlotCount = 8;
+    static const int SlotSize  = 0x0400; // 1KB
+    static const int SlotMask  = 0x03ff;
+    static const int SlotShift = 10;
+
     PatternTables(const std::vector<uint8_t> &memory);
 
     bool contains(uint16_t addr) const override;
@@ -184,9 +256,13 @@ public:
 
     void write(uint16_t address, uint8_t data) override;
 
+    void map(uint16_t address, Page_t &page) override;
+
 private:
 
     const std::vector<uint8_t> &_memory;
+
+    std::array<const uint8_t*, SlotCount> _slots;
 };
 
 /* Memory Mapper */
@@ -162,6 +162,14 @@ typedef struct Operation {
     const int cycles;
 } Operation_t;
 
+/* Operation described by constants, for code built at compile time */
+typedef struct Description {
+    code::InstructionKind_t type;
+    code::AddressingKind_t mode;
+    int cycles;
+    bool known;
+} Description_t;
+
 //! Count of Addressing Modes
 const int AddressingModeSize = code::AbsoluteIndirect + 1;
 
@@ -177,6 +185,107 @@ extern const Operation_t UnknownOperation;
 //! Instruction Set Op Code Matrix
 extern const Operation_t* const OperationSet[OperationSetSize];
 
+/** Instruction Set Op Code Matrix, as a list
+ *
+ * This the whole instruction set of 6502 processor, an 1:1
+ * copy of the manual, in the order of op codes. Each valid
+ * op code is listed as OP(code, instruction, addressing mode,
+ * cycles), and each unknown one as NIL(code)
+ *
+ * The single source of the operations, expanded into the
+ * OperationSet and into the switch of the interpreter
+ */
+#define TONES_OPERATION_SET(OP, NIL) \
+/* 0 */ OP(0x00, BRK, IMP, 7) OP(0x01, ORA, IDX, 6) NIL(0x02)             NIL(0x03) \
+        NIL(0x04)             OP(0x05, ORA, ZP , 3) OP(0x06, ASL, ZP , 5) NIL(0x07) \
+        OP(0x08, PHP, IMP, 3) OP(0x09, ORA, IMM, 2) OP(0x0a, ASL, ACC, 2) NIL(0x0b) \
+        NIL(0x0c)             OP(0x0d, ORA, ABS, 4) OP(0x0e, ASL, ABS, 6) NIL(0x0f) \
+/* 1 */ OP(0x10, BPL, REL, 2) OP(0x11, ORA, IDY, 5) NIL(0x12)             NIL(0x13) \
+        NIL(0x14)             OP(0x15, ORA, ZPX, 4) OP(0x16, ASL, ZPX, 6) NIL(0x17) \
+        OP(0x18, CLC, IMP, 2) OP(0x19, ORA, ABY, 4) NIL(0x1a)             NIL(0x1b) \
+        NIL(0x1c)             OP(0x1d, ORA, ABX, 4) OP(0x1e, ASL, ABX, 7) NIL(0x1f) \
+/* 2 */ OP(0x20, JSR, ABS, 6) OP(0x21, AND, IDX, 6) NIL(0x22)             NIL(0x23) \
+        OP(0x24, BIT, ZP , 3) OP(0x25, AND, ZP , 3) OP(0x26, ROL, ZP , 5) NIL(0x27) \
+        OP(0x28, PLP, IMP, 4) OP(0x29, AND, IMM, 2) OP(0x2a, ROL, ACC, 2) NIL(0x2b) \
+        OP(0x2c, BIT, ABS, 4) OP(0x2d, AND, ABS, 4) OP(0x2e, ROL, ABS, 6) NIL(0x2f) \
+/* 3 */ OP(0x30, BMI, REL, 2) OP(0x31, AND, IDY, 5) NIL(0x32)             NIL(0x33) \
+        NIL(0x34)             OP(0x35, AND, ZPX, 4) OP(0x36, ROL, ZPX, 6) NIL(0x37) \
+        OP(0x38, SEC, IMP, 2) OP(0x39, AND, ABY, 4) NIL(0x3a)             NIL(0x3b) \
+        NIL(0x3c)             OP(0x3d, AND, ABX, 4) OP(0x3e, ROL, ABX, 7) NIL(0x3f) \
+/* 4 */ OP(0x40, RTI, IMP, 6) OP(0x41, EOR, IDX, 6) NIL(0x42)             NIL(0x43) \
+        NIL(0x44)             OP(0x45, EOR, ZP , 3) OP(0x46, LSR, ZP , 5) NIL(0x47) \
+        OP(0x48, PHA, IMP, 3) OP(0x49, EOR, IMM, 2) OP(0x4a, LSR, ACC, 2) NIL(0x4b) \
+        OP(0x4c, JMP, ABS, 3) OP(0x4d, EOR, ABS, 4) OP(0x4e, LSR, ABS, 6) NIL(0x4f) \
+/* 5 */ OP(0x50, BVC, REL, 2) OP(0x51, EOR, IDY, 5) NIL(0x52)             NIL(0x53) \
+        NIL(0x54)             OP(0x55, EOR, ZPX, 4) OP(0x56, LSR, ZPX, 6) NIL(0x57) \
+        OP(0x58, CLI, IMP, 2) OP(0x59, EOR, ABY, 4) NIL(0x5a)             NIL(0x5b) \
+        NIL(0x5c)             OP(0x5d, EOR, ABX, 4) OP(0x5e, LSR, ABX, 7) NIL(0x5f) \
+/* 6 */ OP(0x60, RTS, IMP, 6) OP(0x61, ADC, IDX, 6) NIL(0x62)             NIL(0x63) \
+        NIL(0x64)             OP(0x65, ADC, ZP , 3) OP(0x66, ROR, ZP , 5) NIL(0x67) \
+        OP(0x68, PLA, IMP, 4) OP(0x69, ADC, IMM, 2) OP(0x6a, ROR, ACC, 2) NIL(0x6b) \
+        OP(0x6c, JMP, IND, 5) OP(0x6d, ADC, ABS, 4) OP(0x6e, ROR, ABS, 6) NIL(0x6f) \
+/* 7 */ OP(0x70, BVS, REL, 2) OP(0x71, ADC, IDY, 5) NIL(0x72)             NIL(0x73) \
+        NIL(0x74)             OP(0x75, ADC, ZPX, 4) OP(0x76, ROR, ZPX, 6) NIL(0x77) \
+        OP(0x78, SEI, IMP, 2) OP(0x79, ADC, ABY, 4) NIL(0x7a)             NIL(0x7b) \
+        NIL(0x7c)             OP(0x7d, ADC, ABX, 4) OP(0x7e, ROR, ABX, 7) NIL(0x7f) \
+/* 8 */ NIL(0x80)             OP(0x81, STA, IDX, 6) NIL(0x82)             NIL(0x83) \
+        OP(0x84, STY, ZP , 3) OP(0x85, STA, ZP , 3) OP(0x86, STX, ZP , 3) NIL(0x87) \
+        OP(0x88, DEY, IMP, 2) OP(0x89, STA, IMM, 2) OP(0x8a, TXA, IMP, 2) NIL(0x8b) \
+        OP(0x8c, STY, ABS, 4) OP(0x8d, STA, ABS, 4) OP(0x8e, STX, ABS, 4) NIL(0x8f) \
+/* 9 */ OP(0x90, BCC, REL, 2) OP(0x91, STA, IDY, 5) NIL(0x92)             NIL(0x93) \
+        OP(0x94, STY, ZPX, 4) OP(0x95, STA, ZPX, 4) OP(0x96, STX, ZPY, 4) NIL(0x97) \
+        OP(0x98, TYA, IMP, 2) OP(0x99, STA, ABY, 4) OP(0x9a, TXS, IMP, 2) NIL(0x9b) \
+        NIL(0x9c)             OP(0x9d, STA, ABX, 4) NIL(0x9e)             NIL(0x9f) \
+/* A */ OP(0xa0, LDY, IMM, 2) OP(0xa1, LDA, IDX, 6) OP(0xa2, LDX, IMM, 2) NIL(0xa3) \
+        OP(0xa4, LDY, ZP , 3) OP(0xa5, LDA, ZP , 3) OP(0xa6, LDX, ZP , 3) NIL(0xa7) \
+        OP(0xa8, TAY, IMP, 2) OP(0xa9, LDA, IMM, 2) OP(0xaa, TAX, IMP, 2) NIL(0xab) \
+        OP(0xac, LDY, ABS, 4) OP(0xad, LDA, ABS, 4) OP(0xae, LDX, ABS, 4) NIL(0xaf) \
+/* B */ OP(0xb0, BCS, REL, 2) OP(0xb1, LDA, IDY, 5) NIL(0xb2)             NIL(0xb3) \
+        OP(0xb4, LDY, ZPX, 4) OP(0xb5, LDA, ZPX, 4) OP(0xb6, LDX, ZPY, 4) NIL(0xb7) \
+        OP(0xb8, CLV, IMP, 2) OP(0xb9, LDA, ABY, 4) OP(0xba, TSX, IMP, 2) NIL(0xbb) \
+        OP(0xbc, LDY, ABX, 4) OP(0xbd, LDA, ABX, 4) OP(0xbe, LDX, ABY, 4) NIL(0xbf) \
+/* C */ OP(0xc0, CPY, IMM, 2) OP(0xc1, CMP, IDX, 6) NIL(0xc2)             NIL(0xc3) \
+        OP(0xc4, CPY, ZP , 3) OP(0xc5, CMP, ZP , 3) OP(0xc6, DEC, ZP , 5) NIL(0xc7) \
+        OP(0xc8, INY, IMP, 2) OP(0xc9, CMP, IMM, 2) OP(0xca, DEX, IMP, 2) NIL(0xcb) \
+        OP(0xcc, CPY, ABS, 4) OP(0xcd, CMP, ABS, 4) OP(0xce, DEC, ABS, 6) NIL(0xcf) \
+/* D */ OP(0xd0, BNE, REL, 2) OP(0xd1, CMP, IDY, 5) NIL(0xd2)             NIL(0xd3) \
+        NIL(0xd4)             OP(0xd5, CMP, ZPX, 4) OP(0xd6, DEC, ZPX, 6) NIL(0xd7) \
+        OP(0xd8, CLD, IMP, 2) OP(0xd9, CMP, ABY, 4) NIL(0xda)             NIL(0xdb) \
+        NIL(0xdc)             OP(0xdd, CMP, ABX, 4) OP(0xde, DEC, ABX, 7) NIL(0xdf) \
+/* E */ OP(0xe0, CPX, IMM, 2) OP(0xe1, SBC, IDX, 6) NIL(0xe2)             NIL(0xe3) \
+        OP(0xe4, CPX, ZP , 3) OP(0xe5, SBC, ZP , 3) OP(0xe6, INC, ZP , 5) NIL(0xe7) \
+        OP(0xe8, INX, IMP, 2) OP(0xe9, SBC, IMM, 2) OP(0xea, NOP, IMP, 2) NIL(0xeb) \
+        OP(0xec, CPX, ABS, 4) OP(0xed, SBC, ABS, 4) OP(0xee, INC, ABS, 6) NIL(0xef) \
+/* F */ OP(0xf0, BEQ, REL, 2) OP(0xf1, SBC, IDY, 5) NIL(0xf2)             NIL(0xf3) \
+        NIL(0xf4)             OP(0xf5, SBC, ZPX, 4) OP(0xf6, INC, ZPX, 6) NIL(0xf7) \
+        OP(0xf8, SED, IMP, 2) OP(0xf9, SBC, ABY, 4) NIL(0xfa)             NIL(0xfb) \
+        NIL(0xfc)             OP(0xfd, SBC, ABX, 4) OP(0xfe, INC, ABX, 7) NIL(0xff)
+
+/* Kinds of the addressing modes, by the names in the list */
+#define TONES_MODE_IMP code::Implied
+#define TONES_MODE_ACC code::Accumulator
+#define TONES_MODE_IMM code::Immediate
+#define TONES_MODE_ABS code::Absolute
+#define TONES_MODE_ZP  code::ZeroPage
+#define TONES_MODE_ZPX code::IndexedZeroPageX
+#define TONES_MODE_ZPY code::IndexedZeroPageY
+#define TONES_MODE_ABX code::IndexedAbsoluteX
+#define TONES_MODE_ABY code::IndexedAbsoluteY
+#define TONES_MODE_REL code::Relative
+#define TONES_MODE_IDX code::IndexedIndirect
+#define TONES_MODE_IDY code::IndirectIndexed
+#define TONES_MODE_IND code::AbsoluteIndirect
+
+#define TONES_DESCRIBE_OPERATION(op, type, mode, cycles) \
+    { code::type, TONES_MODE_##mode, cycles, true },
+#define TONES_DESCRIBE_UNKNOWN(op) \
+    { code::NOP, code::Implied, 0, false },
+
+//! Instruction Set Op Code Matrix, as constants
+constexpr Description_t OperationDescriptions[OperationSetSize] = {
+    TONES_OPERATION_SET(TONES_DESCRIBE_OPERATION, TONES_DESCRIBE_UNKNOWN)
+};
+
 } // namespace cpu
 } // namespace tones
 
@@ -0,0 +1,98 @@
+#ifndef _TONES_JIT_H_
+#define _TONES_JIT_H_
+
+#include <cinttypes>
+#include <cstdio>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define TONES_JIT
+#endif
+
+namespace tones {
+
+class MicroProcessor;
+
+namespace cpu {
+struct Block;
+}
+
+namespace jit {
+
+//! Runs of a basic block before it is compiled
+const int HotThreshold = 16;
+
+const int DefaultCapacity = 4 << 20; // bytes
+
+//! Run one predecoded instruction, returns its ticks
+typedef int (*Step)(MicroProcessor &cpu, const uint8_t *operands);
+
+//! Run a compiled block, returns its ticks
+typedef int (*Function)(MicroProcessor &cpu);
+
+/**
+ * @brief x86-64 code of basic blocks
+ *
+ * The instructions of a block are translated one by one, with
+ * registers A, X and Y, and flags N and Z, held in host
+ * registers through the whole block. Flags C and V stay in
+ * the state of the CPU. Operands at addresses known when
+ * compiling are read from and written to their host memory
+ * directly, the others look up the page table of the bus, and
+ * only what is not memory goes through the bus. The stack
+ * instructions, the jumps other than JMP ABS, and the modes
+ * the zero page of which is not memory, call the steps of the
+ * interpreter instead, with the registers written back.
+ *
+ * Writes to a page of RAM holding translated code go through
+ * the CPU, which drops the blocks of RAM then.
+ *
+ * The code is mapped twice, writable to emit it and executable
+ * to run it, and the compiled blocks are listed in
+ * /tmp/perf-<pid>.map, for perf to name them. On hosts other
+ * than x86-64 Linux, nothing is compiled and the blocks are
+ * interpreted.
+ */
+class Compiler
+{
+
+public:
+
+    Compiler(int capacity = DefaultCapacity);
+    ~Compiler();
+
+    //! Compile a block of a CPU at a 6502 address, nullptr if out of space
+    Function compile(MicroProcessor &cpu, const cpu::Block &block, uint16_t address);
+
+    //! Drop all the compiled code
+    void reset();
+
+    //! Bytes of code emitted
+    int size() const;
+
+private:
+
+    /* Called by the compiled code, for what is not memory */
+
+    //! Read a byte through the bus
+    static uint8_t read(MicroProcessor *cpu, uint16_t address);
+
+    //! Write a byte through the bus, dropping the blocks of RAM it changes
+    static void write(MicroProcessor *cpu, uint16_t address, uint8_t data);
+
+private:
+
+    uint8_t *_code; // executable view
+
+    uint8_t *_buffer; // writable view of the same memory
+
+    int _capacity;
+
+    int _size;
+
+    FILE *_perfMap;
+};
+
+} // namespace jit
+} // namespace tones
+
+#endif // _TONES_JIT_H_
@@ -0,0 +1,127 @@
+#ifndef _TONES_LOCKSTEP_H_
+#define _TONES_LOCKSTEP_H_
+
+#include <cinttypes>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Bus.h"
+#include "Device.h"
+#include "Cartridge.h"
+#include "MicroProcessor.h"
+
+namespace tones {
+namespace cpu {
+
+/**
+ * @brief Two CPU cores run side by side, to find where they differ
+ *
+ * Each core runs on its own buses, with copies of the same
+ * cartridge and the same RAM. After each step of the core to
+ * check, the reference core runs as many instructions, then
+ * their registers, the tick of their next instructions and
+ * the writes to their buses are compared. A step is one
+ * instruction, or one block of them for the block cores
+ *
+ * Meant to validate a faster core against the reference one,
+ * on more programs than the logs of the test ROMs
+ */
+class Lockstep
+{
+
+public:
+
+    typedef struct Write {
+        uint16_t address;
+        uint8_t data;
+
+        bool operator==(const Write &other) const
+        {
+            return address == other.address && data == other.data;
+        }
+    } Write_t;
+
+    //! What the two cores did differently, in their first step to differ
+    typedef struct Divergence {
+        uint64_t instruction; // instructions run by both before the step
+        uint16_t address;     // of the first instruction of the step
+        uint8_t opcode;
+
+        MicroProcessor::Registers_t expected, actual;
+        uint64_t expectedTick, actualTick; // of the next instructions, since reset
+        std::vector<Write_t> expectedWrites, actualWrites;
+    } Divergence_t;
+
+public:
+
+    Lockstep(Dispatch reference, Dispatch candidate);
+
+    //! Insert a copy of a cartridge file into each, fails if it fails to load
+    bool insert(const std::string &path);
+
+    //! Reset both, with the RAM of the reference copied to the other one
+    void reset();
+
+    //! Set the register PC of both
+    void jump(uint16_t address);
+
+    //! Run a number of instructions at least, false at the first divergence
+    bool run(uint64_t instructions);
+
+    //! Instructions run by both since power on
+    uint64_t instructions() const;
+
+    const Divergence_t &divergence() const;
+
+    /* The CPUs, to raise interrupts on either of them */
+
+    MicroProcessor &reference();
+
+    MicroProcessor &candidate();
+
+    //! Print the instruction and the state of the divergence
+    void report(std::ostream &out) const;
+
+private:
+
+    /**
+     * @brief The hardwares of one of the cores
+     */
+    struct Machine {
+        Machine(Dispatch dispatch);
+
+        //! Registers, and the tick of the next instruction since reset
+        void dump(MicroProcessor::Registers_t &registers, uint64_t &tick) const;
+
+        Bus mbus, vbus;
+        RandomAccessMemory pram;
+        SaveRandomAccessMemory sram;
+        MicroProcessor cpu;
+        CartridgePtr card;
+
+        //! Ticks at reset, as those pending are dropped
+        uint64_t origin;
+
+        //! Since the start of the step
+        std::vector<Write_t> writes;
+    };
+
+    //! Run one step of each, false if they differ
+    bool step();
+
+private:
+
+    Machine _reference;
+
+    Machine _candidate;
+
+    bool _diverged;
+
+    Divergence_t _divergence;
+};
+
+} // namespace cpu
+} // namespace tones
+
+#endif // _TONES_LOCKSTEP_H_
@@ -4,11 +4,16 @@
 #include <array>
 #include <cinttypes>
 #include <functional>
+#include <memory>
+#include <vector>
 
+#include "Accuracy.h"
 #include "Bus.h"
 #include "Clock.h"
 #include "Register.h"
 #include "Instruction.h"
+#include "Jit.h"
+#include "Profiler.h"
 
 namespace tones {
 
@@ -43,43 +48,158 @@ enum class StatusBit {
     C = 0x01       // Carry
 };
 
+/* Devices holding the IRQ line, which is asserted while any of them does */
+enum class IrqSource {
+    APU    = 0x01,      // frame counter
+    Mapper = 0x01 << 1, // scanline counters of MMC3 and alike
+    DMC    = 0x01 << 2  // end of a sample
+};
+
+/**
+ * @brief Flags N, Z, C and V, evaluated lazily
+ *
+ * Most instructions set these flags, and most of them are set
+ * again before anything reads them. So the values the flags
+ * derive from are kept as they are, and the flags are tested
+ * only by the branches, or merged into register P when it is
+ * pushed or dumped.
+ */
+typedef struct Flags {
+    uint8_t N; // negative if bit 7 is set
+    uint8_t Z; // zero if it is zero
+    uint8_t C; // carry, 0 or 1
+    uint8_t V; // overflow if bit 7 is set
+} Flags_t;
+
+/**
+ * @brief Registers and counters of the CPU
+ *
+ * Everything the instructions work on, in one plain struct
+ * fitting a cache line, which may be copied byte by byte to
+ * save, restore or clone the state of a CPU.
+ */
+typedef struct alignas(64) State {
+    uint64_t cycles;       // ticks elapsed since power on
+    uint64_t instructions; // instructions run since power on
+    uint16_t skip;         // ticks before the next instruction
+
+    /* Programmable Registers */
+    uint16_t PC;      // program counter
+    uint8_t A;        // accumulator
+    uint8_t X;        // index register X
+    uint8_t Y;        // index register Y
+    uint8_t S;        // stack pointer
+    reg::Bitwise_t P; // processor status register, but N, Z, C and V
+    Flags_t flags;    // N, Z, C and V
+
+    /* Internal Registers */
+    uint8_t IR;  // instruction register
+    uint8_t DL;  // data latch
+    uint8_t DBB; // data bus buffer
+    uint16_t AB; // adress buffer
+
+    /* Interrupt Lines, sampled between instructions */
+    uint8_t nmiLine; // level of the NMI line
+    uint8_t nmi;     // edge of the NMI line, until it is served
+    uint8_t irq;     // sources holding the IRQ line
+} State_t;
+
+/* How the decoded operations are run */
+enum class Dispatch {
+    Table,  // by the pointers of the operation set
+    Switch, // by one switch on the op code
+    Fused,  // by handlers built for each op code
+    Cached, // by handlers with the operands predecoded in a cache
+    Block,  // by basic blocks of predecoded handlers, one block a step
+    Native, // by basic blocks, compiled to host code once they are hot
+};
+
+/* Predecoded Instruction Cache */
+const int InstructionCacheSize = 4096;
+const int InstructionCacheMask = InstructionCacheSize - 1;
+
+typedef struct CacheEntry {
+    typedef void (*Handler)(tones::MicroProcessor &cpu, const uint8_t *operands);
+
+    const uint8_t *tag; // host memory of the op code
+    Handler handler;
+    uint8_t opcode;
+    uint8_t operands[2];
+} CacheEntry_t;
+
+/* Basic Blocks
+ *
+ * Straight-line runs of instructions in read-only memory, ending
+ * at a branch, a jump, RTS, RTI or BRK, and just before anything
+ * which may access a device other than memory, unless it is a
+ * read by the first instruction. The native dispatch takes the
+ * runs in RAM too, ending them after any write, and drops them
+ * once the CPU writes to their pages
+ */
+const int BlockMaxLength = 32; // instructions
+
+//! One instruction, or a superinstruction of a few in a row
+typedef struct BlockStep {
+    jit::Step run;
+    uint8_t opcode;      // of the first instruction
+    uint8_t length;      // instructions
+    uint8_t operands[4]; // of all the instructions
+} BlockStep_t;
+
+typedef struct Block {
+    const uint8_t *tag; // host memory of the entry
+    std::vector<BlockStep_t> steps; // empty if interpreted instead
+    int instructions;
+    bool idle;          // loops to itself, reading only and writing nothing
+    bool writable;      // in RAM, dropped on writes to its pages
+    int runs;           // before it is compiled
+    jit::Function native;
+} Block_t;
+
+//! CPU ticks to come, before anything may change what the CPU reads or interrupt it
+typedef std::function<uint32_t(void)> Horizon;
+
 class InstructionDecoder;
+class FusedCore;
+class BlockCore;
+class CycleCountedCore;
 
 /**
  * @brief ALU
  * 
+ * Holds nothing, it operates on the state of a CPU
  */
 class ArithmeticAndLogicUnit
 {
     friend class InstructionDecoder;
+    friend class FusedCore;
+    friend class CycleCountedCore;
     friend class tones::MicroProcessor;
 
 private:
 
-    ArithmeticAndLogicUnit(tones::MicroProcessor &cpu);
-
     /* One operand operations
      *
      * These operations only work on the accumulator
      */
 
     //! Increment the accumulator by one
-    inline void INC();
+    static inline void INC(State_t &state);
     
     //! Decrement the accumulator by one
-    inline void DEC();
+    static inline void DEC(State_t &state);
 
     //! Shift one bit left
-    inline void ASL();
+    static inline void ASL(State_t &state);
 
     //! Shift one bit right
-    inline void LSR();
+    static inline void LSR(State_t &state);
 
     //! Rotate one bit left
-    inline void ROL();
+    static inline void ROL(State_t &state);
 
     //! Rotate one bit right
-    inline void ROR();
+    static inline void ROR(State_t &state);
 
     /* Two operands operations
      *
@@ -88,51 +208,47 @@ private:
      */
 
     //! Operation logic 'OR'
-    inline void ORA();
+    static inline void ORA(State_t &state);
 
     //! Operation logic 'AND'
-    inline void AND();
+    static inline void AND(State_t &state);
 
     //! Operation logic 'Exclusive OR'
-    inline void EOR();
+    static inline void EOR(State_t &state);
 
     //! Operation arithmetic 'Add'
-    inline void ADC();
+    static inline void ADC(State_t &state);
 
     //! Operation arithmetic 'Subtract'
-    inline void SBC();
+    static inline void SBC(State_t &state);
 
     //! Operation arithmetic 'Compare'
-    inline void CMP();
+    static inline void CMP(State_t &state);
 
     /* Access Status Register */
 
-    inline void setZero(uint8_t reg);
-
-    inline void setNegative(uint8_t reg);
+    static inline void setZero(State_t &state, uint8_t reg);
 
-    inline void setZeroNegative(uint8_t reg);
+    static inline void setNegative(State_t &state, uint8_t reg);
 
-    inline void setCarry(bool val);
+    static inline void setZeroNegative(State_t &state, uint8_t reg);
 
-    inline void setOverflow(bool val);
+    static inline void setCarry(State_t &state, bool val);
 
-    inline bool getZero();
+    //! Overflow if bit 7 of the value is set
+    static inline void setOverflow(State_t &state, uint8_t reg);
 
-    inline bool getNegative();
+    static inline bool getZero(State_t &state);
 
-    inline bool getCarry();
+    static inline bool getNegative(State_t &state);
 
-    inline bool getOverflow();
-
-private:
+    static inline bool getCarry(State_t &state);
 
-    /* Registers refered to the cpu */
-    uint8_t &_reg_A;
-    uint8_t &_reg_DBB;
-    reg::Bitwise_t &_reg_P;
+    static inline bool getOverflow(State_t &state);
 };
 
+typedef ArithmeticAndLogicUnit ALU;
+
 /**
  * @brief Instruction Decoder
  *
@@ -141,6 +257,7 @@ class InstructionDecoder
 {
     friend class tones::MicroProcessor;
     friend class ArithmeticAndLogicUnit;
+    friend class CycleCountedCore;
 
 public:
 
@@ -290,13 +407,13 @@ private:
 
     // TODO: A better way?
     //! Execute operations of accumulate addressing mode
-    inline void accumulate(void (ArithmeticAndLogicUnit::*executor)());
+    inline void accumulate(void (*executor)(State_t &state));
 
 private:
 
     MicroProcessor &_cpu;
 
-    ArithmeticAndLogicUnit &_alu;
+    State_t &_state;
 
     const Operation_t *_operation;
 };
@@ -311,6 +428,10 @@ class MicroProcessor : public Tickable
 {
     friend class cpu::InstructionDecoder;
     friend class cpu::ArithmeticAndLogicUnit;
+    friend class cpu::FusedCore;
+    friend class cpu::BlockCore;
+    friend class cpu::CycleCountedCore;
+    friend class jit::Compiler;
 
 public:
 
@@ -333,19 +454,46 @@ public:
 
     void tick() override;
 
+    //! Run the ticks of a budget, returns those the last instruction runs over it
+    template <class Policy = accuracy::Fast>
+    uint16_t run(uint32_t cycles);
+
+    //! Run until the next instruction is done
+    template <class Policy = accuracy::Fast>
     void step();
 
     void reset();
 
-    //! Hardware interrupt request (IRQ)
-    void irq();
+    //! Hold or release the IRQ line, for a source
+    void setIrq(cpu::IrqSource source, bool level);
+
+    //! Drive the NMI line, an NMI is raised on its rising edge
+    void setNmi(bool level);
 
-    //! Hardware non-maskable interrupt (NMI)
+    //! A pulse on the NMI line
     void nmi();
 
-    //! Block the CPU for a few ticks
+    //! An interrupt is served in place of the next instruction
+    bool pending() const;
+
+    //! Block the CPU for a few ticks, from the instruction being run
     void wait(uint16_t ticks);
 
+    //! Ticks elapsed since power on, referenced to stamp events
+    const uint64_t &cycles() const;
+
+    //! Instructions run since power on
+    const uint64_t &instructions() const;
+
+    //! Choose the interpreter core, the switch one by default
+    void setDispatch(cpu::Dispatch dispatch);
+
+    //! Count the pairs of op codes run by the Table, Switch and Fused cores
+    void setProfiler(cpu::Profiler *profiler);
+
+    //! Let the block cores skip the iterations of idle loops until the horizon
+    void setHorizon(cpu::Horizon horizon);
+
     /* Functions for debugging */
 
     //! Set the register PC to a given address
@@ -354,6 +502,12 @@ public:
     //! Copy all the inner registers
     void dump(Registers_t &registers) const;
 
+    //! Copy the whole state, to restore it later or into another CPU
+    void save(cpu::State_t &state) const;
+
+    //! Restore a state saved from this CPU or another one on the same bus
+    void restore(const cpu::State_t &state);
+
     /* Functions for addressing modes */
     
     //! Dose not fetch
@@ -397,12 +551,33 @@ protected:
     //! Handle interrupt request
     void interrupt(uint16_t vector);
 
+    //! Drop the blocks in RAM, which may have been written
+    void invalidate();
+
+    //! Run one instruction, or one block of them, on its first tick
+    inline void execute();
+
+    //! Serve an NMI, or an IRQ unless it is disabled
+    inline bool serve();
+
+    //! Register P, with the lazy flags evaluated
+    inline uint8_t status() const;
+
+    //! Load register P, and the lazy flags out of it
+    inline void setStatus(uint8_t status);
+
     //! Read one byte from memory
     inline void read();
 
     //! Write one byte to memory
     inline void write();
 
+    //! Read one byte from a page known in advance
+    inline void read(const Page_t &page);
+
+    //! Write one byte to a page known in advance
+    inline void write(const Page_t &page);
+
     //! Push into stack
     inline void push();
 
@@ -415,6 +590,9 @@ protected:
     //! Fetch operands
     inline void fetch();
 
+    //! Decode, fetch and execute in one switch on the op code
+    inline void dispatch();
+
     /* Helper Functions */
 
     //! Pop from stack twice, continuously
@@ -443,27 +621,44 @@ protected:
 
 private:
 
-    uint16_t _skip;
+    cpu::State_t _state;
 
-    /* Programmable Registers */
-    uint8_t  _reg_A;  // accumulator
-    uint8_t  _reg_X;  // index register X
-    uint8_t  _reg_Y;  // index register Y
-    uint8_t  _reg_S;  // stack pointer
-    uint16_t _reg_PC; // program counter
+    cpu::Dispatch _dispatch;
 
-    reg::Bitwise_t _reg_P; // processor status register
+    //! Instructions in read-only memory, indexed by PC
+    std::vector<cpu::CacheEntry_t> _cache;
 
-    /* Internal Registers */
-    uint8_t  _reg_IR;  // instruction register
-    uint8_t  _reg_DL;  // data latch
-    uint8_t  _reg_DBB; // data bus buffer
-    uint16_t _reg_AB;  // adress buffer
+    //! Basic blocks, indexed by PC of their entries
+    std::vector<cpu::Block_t> _blocks;
+
+    //! Pages of the CPU whose writes may change the blocks in RAM
+    std::array<uint8_t, PageCount> _codePages;
+
+    cpu::Profiler *_profiler;
+
+    cpu::Horizon _horizon;
+
+    //! Instructions run when an idle loop ran one iteration, to confirm it
+    uint64_t _idleMark;
+
+    uint16_t _idleEntry;
+
+    //! Compiler of the hot blocks
+    std::unique_ptr<jit::Compiler> _jit;
+
+    //! Generation of the bus the caches are built on
+    uint32_t _cacheGeneration;
 
     cpu::InstructionDecoder _decoder;
-    cpu::ArithmeticAndLogicUnit _alu;
 
     Bus &_bus;
+
+    /* Pages always backed by the internal RAM, accessed at
+     * their host memory directly when it is mapped, without
+     * looking up the page table of the bus
+     */
+    const Page_t &_zeroPage;
+    const Page_t &_stackPage;
 };
 
 } // namespace tones
@@ -23,7 +23,6 @@
 #include <functional>
 
 #include "Bus.h"
-#include "Clock.h"
 #include "Device.h"
 #include "MicroProcessor.h"
 #include "PictureProcessingUnit.h"
@@ -66,6 +65,61 @@ private:
     std::function<void(void)> _handler;
 };
 
+/**
+ * @brief The PPU run behind the CPU, caught up when it matters
+ *
+ * The CPU runs ahead by as many ticks as the PPU stays quiet,
+ * before it may raise an NMI or change its status. The PPU is
+ * brought up to the CPU when the CPU accesses its registers,
+ * the OAM DMA included, and at the end of each run. Same as
+ * one CPU tick then the PPU ticks of it, each master tick,
+ * without the calls of the ticks nothing happens on
+ *
+ * The fast variants of both are run
+ */
+class CatchUp
+{
+
+public:
+
+    //! With the PPU ticks per CPU tick
+    CatchUp(MicroProcessor &cpu, PictureProcessingUnit &ppu, int ratio);
+
+    //! Run some CPU ticks, at most, and the PPU up to them, returns those run
+    uint32_t ahead(uint32_t ticks);
+
+    //! Run a number of CPU ticks, and the PPU up to them
+    void run(uint32_t ticks);
+
+    //! Run the PPU up to the tick the CPU runs on, before it accesses the PPU
+    void sync();
+
+    //! Run the PPU up to all the ticks the CPU has run
+    void align();
+
+    //! Since the CPU, for its horizon
+    uint32_t quietTicks() const;
+
+    //! Take the PPU as up to the CPU, once both are reset
+    void reset();
+
+private:
+
+    //! Run the PPU up to a tick of the CPU
+    inline void advance(uint64_t tick);
+
+private:
+
+    MicroProcessor &_cpu;
+
+    PictureProcessingUnit &_ppu;
+
+    const int _ratio;
+
+    //! Ticks of the CPU the PPU is up to
+    uint64_t _synced;
+};
+
 /**
  * @brief A base class to get the output signals
  *
@@ -91,6 +145,20 @@ public:
     /* Debug Infos */
 
     virtual void onRegistersChanged() {}
+
+    virtual void onCpuWatchpoint(uint16_t address, uint8_t data, Access access)
+    {
+        (void)address;
+        (void)data;
+        (void)access;
+    }
+
+    virtual void onPpuWatchpoint(uint16_t address, uint8_t data, Access access)
+    {
+        (void)address;
+        (void)data;
+        (void)access;
+    }
 };
 
 /**
@@ -102,7 +170,8 @@ class MotherBoard
 
 public:
 
-    MotherBoard();
+    //! With the core of the CPU to run, the switch interpreter by default
+    MotherBoard(cpu::Dispatch dispatch = cpu::Dispatch::Switch);
 
     void insert(CartridgePtr &card);
 
@@ -140,6 +209,31 @@ public:
 
     void dumpPpuOam(std::array<uint8_t, ppu::SpriteMemorySize> &oam);
 
+    /* Watchpoints, reported to the output panel */
+
+    void watchCpuMemory(uint16_t address, Access access);
+
+    void unwatchCpuMemory(uint16_t address, Access access);
+
+    void watchPpuMemory(uint16_t address, Access access);
+
+    void unwatchPpuMemory(uint16_t address, Access access);
+
+    /* Cheats, Game Genie or raw codes */
+
+    //! Apply a cheat to the inserted cartridge, fails if the code is invalid
+    bool addCheat(const std::string &code);
+
+    void clearCheats();
+
+#ifdef TONES_BUS_TRACE
+    /* Bus trace to a binary file of trace::Record_t, toggled while paused */
+
+    bool startTrace(const std::string &path);
+
+    void stopTrace();
+#endif
+
     /* Callbacks */
 
     void setOutputPanel(OutputPanel &output);
@@ -160,12 +254,12 @@ private:
 
     Bus _vbus; // Bus of PPU
 
-    Clock _clock;
-
     MicroProcessor _cpu;
 
     PictureProcessingUnit _ppu;
 
+    CatchUp _catchUp; // of the PPU, by the CPU
+
     RandomAccessMemory _pram; // RAM of CPU
 
     VideoRandomAccessMemory _vram; // RAM of PPU
@@ -175,6 +269,12 @@ private:
     // TODO: DMC DMA
     DirectMemoryAccess _odma; // OAM DMA
 
+#ifdef TONES_BUS_TRACE
+    trace::RingBuffer _tracer;
+
+    trace::Writer _traceWriter;
+#endif
+
     CartridgePtr _card;
 
     /* Flags */
@@ -5,6 +5,7 @@
 #include <functional>
 #include <tuple>
 
+#include "Accuracy.h"
 #include "Bus.h"
 #include "Clock.h"
 #include "Device.h"
@@ -16,6 +17,8 @@ typedef std::function<void(void)> VBlank;
 
 typedef std::function<void(void)> FrameEnd;
 
+typedef std::function<void(void)> Sync;
+
 typedef std::function<void(int x, int y, uint32_t color)> VideoOut;
 
 class PictureProcessingUnit;
@@ -122,6 +125,12 @@ public:
 
     void write(uint16_t address, uint8_t data) override;
 
+    void peek(uint16_t address, uint8_t &buffer) const override;
+
+    bool stable(uint16_t address) const override;
+
+    void transfer(uint16_t address, const uint8_t *data, int length) override;
+
 private:
 
     tones::PictureProcessingUnit &_ppu;
@@ -148,6 +157,8 @@ public:
 
     void write(uint16_t address, uint8_t data) override;
 
+    void map(uint16_t address, Page_t &page) override;
+
     void dump(std::array <uint8_t, PalettesSize> &colors) const;
 
 private:
@@ -217,6 +228,10 @@ public:
 
     void tick() override;
 
+    //! Run a number of dots, passing those nothing happens on at once if fast
+    template <class Policy = accuracy::Fast>
+    void run(uint32_t dots);
+
     void reset();
 
     void setBlankHandler(VBlank handler);
@@ -225,6 +240,12 @@ public:
 
     void setFrameEnd(FrameEnd flush);
 
+    //! Called before the registers are accessed by the CPU, to bring the PPU up to it
+    void setSync(Sync sync);
+
+    //! PPU ticks to come before the status may change, or an NMI be raised
+    uint32_t quietDots() const;
+
     void dump(Registers_t &registers) const;
 
     void dumpPpuOam(std::array<uint8_t, ppu::SpriteMemorySize> &oam);
@@ -250,6 +271,9 @@ protected:
 
     /* Register Accessing */
 
+    //! Catch up with the CPU, if the PPU is run behind it
+    inline void sync();
+
     void readPPUSTATUS();
 
     void readOAMDATA();
@@ -264,6 +288,9 @@ protected:
 
     void writeOAMDATA();
 
+    //! Write a block to OAM, for OAM DMA
+    void writeOAMDATA(const uint8_t *data, int length);
+
     void writePPUSCROLL();
 
     void writePPUADDR();
@@ -275,6 +302,12 @@ protected:
     //! Increase the indexes
     void forward();
 
+    //! Dots from the current one nothing happens on, in its scanline
+    inline uint32_t idleDots();
+
+    //! Pass a few dots nothing happens on, as forward() does each of them
+    inline void pass(uint32_t dots);
+
     //! For pre-render scanline
     void linePre();
 
@@ -380,6 +413,8 @@ private:
     VideoOut _output;
 
     FrameEnd _flush;
+
+    Sync _sync;
 };
 
 } // namespace tones
@@ -0,0 +1,73 @@
+#ifndef _TONES_PROFILER_H_
+#define _TONES_PROFILER_H_
+
+#include <cinttypes>
+#include <ostream>
+#include <vector>
+
+namespace tones {
+namespace cpu {
+
+/**
+ * @brief Counts of the pairs of op codes run in a row
+ *
+ * Filled by the interpreter cores of the CPU, and kept across
+ * ROMs, to find the sequences worth fusing into one handler
+ */
+class Profiler
+{
+
+public:
+
+    typedef struct Pair {
+        uint8_t first;
+        uint8_t second;
+        uint64_t count;
+    } Pair_t;
+
+public:
+
+    Profiler();
+
+    //! Count the pair of the last op code and this one
+    inline void record(uint8_t opcode);
+
+    //! Do not pair the next op code with the last one, like between ROMs
+    void restart();
+
+    //! Drop all the counts
+    void clear();
+
+    //! Op codes recorded
+    uint64_t total() const;
+
+    uint64_t count(uint8_t first, uint8_t second) const;
+
+    //! The most frequent pairs, in descending order
+    std::vector<Pair_t> hottest(int count) const;
+
+    //! Print the most frequent pairs, by their mnemonics
+    void report(std::ostream &out, int count) const;
+
+private:
+
+    std::vector<uint64_t> _pairs;
+
+    uint64_t _total;
+
+    int _last; // op code, or -1 for none
+};
+
+inline void Profiler::record(uint8_t opcode)
+{
+    if (_last >= 0)
+        ++_pairs[_last << 8 | opcode];
+
+    _last = opcode;
+    ++_total;
+}
+
+} // namespace cpu
+} // namespace tones
+
+#endif // _TONES_PROFILER_H_
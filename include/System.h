@@ -0,0 +1,224 @@
+#ifndef _TONES_SYSTEM_H_
+#define _TONES_SYSTEM_H_
+
+#include <cinttypes>
+
+#include "Accuracy.h"
+#include "Bus.h"
+#include "Device.h"
+#include "MicroProcessor.h"
+#include "PictureProcessingUnit.h"
+#include "Cartridge.h"
+#include "MotherBoard.h"
+
+namespace tones {
+namespace board {
+
+/**
+ * @brief NROM, or mapper 0
+ *
+ * Fixed PRG-ROM and CHR-ROM banks, without a memory mapper
+ */
+struct NROM {
+    static const int Mapper = 0;
+    static const int CpuTicks = 1;  // CPU ticks per master tick
+    static const int PpuTicks = 3;  // PPU ticks per master tick
+    static const uint32_t Frequency = 29781; // master ticks per frame
+};
+
+} // namespace board
+
+/**
+ * @brief A whole system composed at compile time
+ *
+ * Same hardwares as MotherBoard, with the clock ratios and
+ * the mapper given by the board as constants. The devices
+ * are members of their own types, so the clock is unrolled
+ * into direct calls of each tick(), instead of the virtual
+ * ones of Clock, for a frame loop without indirections
+ *
+ * The policy of accuracy picks the variants of the CPU and
+ * the PPU, the fast ones by default, or the cycle-counted ones.
+ * The fast PPU is run behind the CPU, and caught up by it,
+ * the cycle-counted one is run at each master tick
+ *
+ * Meant for running games at full speed, MotherBoard is
+ * still the one with the hooks for debugging
+ */
+template <class Board, class Policy = accuracy::Fast>
+class System
+{
+
+public:
+
+    System();
+
+    //! Insert a cartridge, fails if it is not of the board
+    bool insert(CartridgePtr &card);
+
+    void reset();
+
+    //! One master tick
+    inline void tick();
+
+    //! Master ticks of a whole frame
+    void frame();
+
+    void setVideoOut(VideoOut output);
+
+    void setFrameEnd(FrameEnd flush);
+
+    //! Choose the core of the CPU
+    void setDispatch(cpu::Dispatch dispatch);
+
+    void dumpCpuRegisters(MicroProcessor::Registers_t &regs) const;
+
+    void dumpPpuRegisters(PictureProcessingUnit::Registers_t &regs) const;
+
+protected:
+
+    void eject();
+
+private:
+
+    /* Hardwares */
+
+    Bus _mbus; // Bus of CPU
+
+    Bus _vbus; // Bus of PPU
+
+    MicroProcessor _cpu;
+
+    PictureProcessingUnit _ppu;
+
+    CatchUp _catchUp; // of the PPU, by the CPU
+
+    RandomAccessMemory _pram; // RAM of CPU
+
+    VideoRandomAccessMemory _vram; // RAM of PPU
+
+    SaveRandomAccessMemory _sram; // Save RAM
+
+    DirectMemoryAccess _odma; // OAM DMA
+
+    CartridgePtr _card;
+};
+
+typedef System<board::NROM> NromSystem;
+typedef System<board::NROM, accuracy::CycleCounted> CycleCountedNromSystem;
+
+template <class Board, class Policy>
+System<Board, Policy>::System()
+    : _cpu(_mbus)
+    , _ppu(_vbus, _mbus)
+    , _catchUp(_cpu, _ppu, Board::PpuTicks / Board::CpuTicks)
+    , _odma(OAMDMA, ppu::OAMDATA, ppu::SpriteMemorySize)
+{
+    _pram.attach(_mbus);
+    _sram.attach(_mbus);
+    _vram.attach(_vbus);
+
+    _odma.attach(_mbus);
+    _odma.setHandler([this] () {
+        _cpu.wait(513);
+    });
+
+    _ppu.setBlankHandler([this] () { _cpu.nmi(); });
+
+    if (!Policy::CountsCycles)
+        _ppu.setSync([this] () { _catchUp.sync(); });
+
+    // Nothing but the PPU changes what the CPU reads, or interrupts it
+    _cpu.setHorizon([this] () {
+        return Policy::CountsCycles ? _ppu.quietDots() / Board::PpuTicks * Board::CpuTicks
+                                : _catchUp.quietTicks();
+    });
+}
+
+template <class Board, class Policy>
+bool System<Board, Policy>::insert(CartridgePtr &card)
+{
+    if (!card || card->mapper() != Board::Mapper)
+        return false;
+
+    eject();
+    _card = card;
+    _card->attach(_mbus, _vbus);
+    _vram.setMirroring(_card->mirroring());
+    reset();
+    return true;
+}
+
+template <class Board, class Policy>
+void System<Board, Policy>::reset()
+{
+    _cpu.reset();
+    _ppu.reset();
+    _catchUp.reset();
+}
+
+template <class Board, class Policy>
+inline void System<Board, Policy>::tick()
+{
+    // In the order of the devices attached to Clock
+    if (Policy::CountsCycles) {
+        _cpu.run<Policy>(Board::CpuTicks);
+        _ppu.run<Policy>(Board::PpuTicks);
+    } else {
+        _catchUp.run(Board::CpuTicks);
+    }
+}
+
+template <class Board, class Policy>
+void System<Board, Policy>::frame()
+{
+    if (Policy::CountsCycles) {
+        for (uint32_t i = 0; i < Board::Frequency; ++i)
+            tick();
+    } else {
+        _catchUp.run(Board::Frequency * Board::CpuTicks);
+    }
+}
+
+template <class Board, class Policy>
+void System<Board, Policy>::setVideoOut(VideoOut output)
+{
+    _ppu.setVideoOut(output);
+}
+
+template <class Board, class Policy>
+void System<Board, Policy>::setFrameEnd(FrameEnd flush)
+{
+    _ppu.setFrameEnd(flush);
+}
+
+template <class Board, class Policy>
+void System<Board, Policy>::setDispatch(cpu::Dispatch dispatch)
+{
+    _cpu.setDispatch(dispatch);
+}
+
+template <class Board, class Policy>
+void System<Board, Policy>::dumpCpuRegisters(MicroProcessor::Registers_t &regs) const
+{
+    _cpu.dump(regs);
+}
+
+template <class Board, class Policy>
+void System<Board, Policy>::dumpPpuRegisters(PictureProcessingUnit::Registers_t &regs) const
+{
+    _ppu.dump(regs);
+}
+
+template <class Board, class Policy>
+void System<Board, Policy>::eject()
+{
+    if (_card) {
+        _card->detach();
+        _card.reset();
+    }
+}
+
+} // namespace tones
+
+#endif // _TONES_SYSTEM_H_
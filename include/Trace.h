@@ -0,0 +1,136 @@
+#ifndef _TONES_TRACE_H_
+#define _TONES_TRACE_H_
+
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tones {
+namespace trace {
+
+/* Buses to tell the records apart */
+const uint8_t CpuBus = 0;
+const uint8_t PpuBus = 1;
+
+const int DefaultCapacity = 1 << 16; // records
+
+/**
+ * @brief One bus transaction
+ *
+ * Written to the trace file as it is, 16 bytes in the byte
+ * order of the host
+ */
+typedef struct Record {
+    uint64_t cycle;   // CPU cycle of the access
+    uint16_t address; // address on the bus
+    uint8_t  data;    // byte read or written
+    uint8_t  access;  // value of tones::Access
+    uint8_t  bus;     // CpuBus or PpuBus
+    uint8_t  reserved[3];
+} Record_t;
+
+/**
+ * @brief Lock-free ring buffer of bus transactions
+ *
+ * Filled by the emulation thread and drained by one consumer
+ * thread. Records are dropped and counted while the buffer
+ * is full, so the emulation never waits for the consumer
+ */
+class RingBuffer
+{
+
+public:
+
+    //! The capacity is rounded up to a power of two
+    RingBuffer(int capacity = DefaultCapacity);
+
+    //! Take the CPU cycles to stamp the records with
+    void setClock(const uint64_t *cycles);
+
+    //! Producer side, called by the bus on each access
+    inline void record(uint8_t bus, uint16_t address, uint8_t data, uint8_t access);
+
+    //! Consumer side, move up to count records out of the buffer
+    int drain(Record_t *records, int count);
+
+    //! Records lost as the buffer was full
+    uint64_t dropped() const;
+
+private:
+
+    std::vector<Record_t> _records;
+
+    const uint32_t _mask;
+
+    const uint64_t *_cycles;
+
+    // Written by the producer only
+    alignas(64) std::atomic<uint32_t> _head;
+
+    uint64_t _dropped;
+
+    // Written by the consumer only
+    alignas(64) std::atomic<uint32_t> _tail;
+};
+
+/**
+ * @brief Thread draining a ring buffer to a binary file
+ */
+class Writer
+{
+
+public:
+
+    Writer(RingBuffer &buffer);
+    ~Writer();
+
+    //! Start draining to a file, fails if it cannot be created
+    bool open(const std::string &path);
+
+    //! Drain what is left, and close the file
+    void close();
+
+    bool isOpen() const;
+
+protected:
+
+    void run();
+
+    void flush();
+
+private:
+
+    RingBuffer &_buffer;
+
+    std::FILE *_file;
+
+    std::thread _thread;
+
+    std::atomic<bool> _running;
+};
+
+inline void RingBuffer::record(uint8_t bus, uint16_t address, uint8_t data, uint8_t access)
+{
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) > _mask) {
+        ++_dropped;
+        return;
+    }
+
+    Record_t &record = _records[head & _mask];
+    record.cycle = _cycles ? *_cycles : 0;
+    record.address = address;
+    record.data = data;
+    record.access = access;
+    record.bus = bus;
+
+    _head.store(head + 1, std::memory_order_release);
+}
+
+} // namespace trace
+} // namespace tones
+
+#endif // _TONES_TRACE_H_
@@ -0,0 +1,511 @@
+#include "Batch.h"
+
+#include <algorithm>
+#include <iomanip>
+
+#include "Device.h"
+#include "Instruction.h"
+#include "Log.h"
+#include "Register.h"
+
+namespace tones {
+namespace cpu {
+
+/* LaneMemory */
+
+LaneMemory::LaneMemory(int lanes)
+    : _lanes(lanes)
+    , _lane(0)
+    , _memory(RandomAccessMemory::RamSize * lanes)
+{
+}
+
+bool LaneMemory::contains(uint16_t addr) const
+{
+    return addr < RandomAccessMemory::RamUpperBound;
+}
+
+void LaneMemory::read(uint16_t address, uint8_t &buffer) const
+{
+    buffer = _memory[(address & RandomAccessMemory::RamMask) * _lanes + _lane];
+}
+
+void LaneMemory::write(uint16_t address, uint8_t data)
+{
+    _memory[(address & RandomAccessMemory::RamMask) * _lanes + _lane] = data;
+}
+
+void LaneMemory::setLane(int lane)
+{
+    _lane = lane;
+}
+
+inline uint8_t *LaneMemory::lanes(uint16_t address)
+{
+    return &_memory[(address & RandomAccessMemory::RamMask) * _lanes];
+}
+
+/* Masked Loops */
+
+// Built for AVX2 too, the one the host runs picked when loaded
+#if defined(__x86_64__) && defined(__linux__)
+#define LANE_LOOPS __attribute__((target_clones("avx2", "default")))
+#else
+#define LANE_LOOPS
+#endif
+
+//! New values on the lanes of the mask, the old ones on the others
+static inline uint8_t blend(uint8_t mask, uint8_t value, uint8_t old)
+{
+    return (value & mask) | (old & ~mask);
+}
+
+//! Bytes of the operands following an op code
+static int operandsOf(code::AddressingKind_t mode)
+{
+    switch (mode) {
+        case code::Implied:
+        case code::Accumulator:
+            return 0;
+        case code::Absolute:
+        case code::IndexedAbsoluteX:
+        case code::IndexedAbsoluteY:
+        case code::AbsoluteIndirect:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+/* Batch */
+
+Batch::Batch(int lanes)
+    : _lanes(lanes)
+    , _reg_PC(lanes), _reg_A(lanes), _reg_X(lanes), _reg_Y(lanes), _reg_S(lanes), _reg_P(lanes)
+    , _flag_N(lanes), _flag_Z(lanes), _flag_C(lanes), _flag_V(lanes)
+    , _ticks(lanes)
+    , _pending(lanes), _mask(lanes), _operand(lanes)
+    , _ram(lanes)
+    , _cpu(_mbus)
+    , _occupancy()
+{
+    _ram.attach(_mbus);
+}
+
+bool Batch::insert(const std::string &path)
+{
+    CartridgePtr card = CartridgeFactory::createCartridge(path);
+    if (!card)
+        return false;
+
+    // Other mappers switch banks, so that the code differs between lanes
+    if (card->mapper() != 0) {
+        LOG_ERROR() << "Batches run cartridges of mapper 0 only, not " << card->mapper();
+        return false;
+    }
+
+    if (_card)
+        _card->detach();
+
+    _card = card;
+    _card->attach(_mbus, _vbus);
+
+    reset();
+    return true;
+}
+
+void Batch::reset()
+{
+    for (int l = 0; l < _lanes; ++l) {
+        _ram.setLane(l);
+        for (int address = 0; address < RandomAccessMemory::RamSize; ++address)
+            _ram.write(address, 0);
+    }
+
+    State_t state;
+    _cpu.reset();
+    _cpu.save(state);
+
+    std::fill(_reg_PC.begin(), _reg_PC.end(), state.PC);
+    std::fill(_reg_A.begin(), _reg_A.end(), state.A);
+    std::fill(_reg_X.begin(), _reg_X.end(), state.X);
+    std::fill(_reg_Y.begin(), _reg_Y.end(), state.Y);
+    std::fill(_reg_S.begin(), _reg_S.end(), state.S);
+    std::fill(_reg_P.begin(), _reg_P.end(), state.P);
+    std::fill(_flag_N.begin(), _flag_N.end(), state.flags.N);
+    std::fill(_flag_Z.begin(), _flag_Z.end(), state.flags.Z);
+    std::fill(_flag_C.begin(), _flag_C.end(), state.flags.C);
+    std::fill(_flag_V.begin(), _flag_V.end(), state.flags.V);
+    std::fill(_ticks.begin(), _ticks.end(), 0);
+
+    _occupancy = Occupancy_t();
+}
+
+void Batch::jump(uint16_t address)
+{
+    std::fill(_reg_PC.begin(), _reg_PC.end(), address);
+}
+
+void Batch::write(int lane, uint16_t address, uint8_t data)
+{
+    _ram.setLane(lane);
+    _mbus.write(address, data);
+}
+
+uint8_t Batch::read(int lane, uint16_t address)
+{
+    uint8_t data;
+    _ram.setLane(lane);
+    _mbus.peek(address, data);
+    return data;
+}
+
+void Batch::run(uint64_t rounds)
+{
+    for (uint64_t round = 0; round < rounds; ++round) {
+        std::fill(_pending.begin(), _pending.end(), 0xff);
+
+        for (int first = 0; first < _lanes; ++first) {
+            if (!_pending[first])
+                continue;
+
+            // The group of the lanes at the PC of the first one left
+            const uint16_t pc = _reg_PC[first];
+            int count = 0;
+            for (int l = 0; l < _lanes; ++l) {
+                _mask[l] = _pending[l] & -(uint8_t)(_reg_PC[l] == pc);
+                _pending[l] &= ~_mask[l];
+                count += _mask[l] & 1;
+            }
+
+            if (count > 1 && vector(_mask.data(), pc)) {
+                ++_occupancy.vectorSteps;
+                _occupancy.vectorLanes += count;
+                continue;
+            }
+
+            for (int l = first; l < _lanes; ++l) {
+                if (_mask[l])
+                    scalar(l);
+            }
+            _occupancy.scalarSteps += count;
+        }
+    }
+}
+
+int Batch::lanes() const
+{
+    return _lanes;
+}
+
+void Batch::dump(int lane, MicroProcessor::Registers_t &registers) const
+{
+    uint8_t status = _reg_P[lane];
+    SET_BIT(status, StatusBit::N, _flag_N[lane] & 0x80);
+    SET_BIT(status, StatusBit::V, _flag_V[lane] & 0x80);
+    SET_BIT(status, StatusBit::Z, !_flag_Z[lane]);
+    SET_BIT(status, StatusBit::C, _flag_C[lane]);
+
+    registers.A = _reg_A[lane];
+    registers.X = _reg_X[lane];
+    registers.Y = _reg_Y[lane];
+    registers.S = _reg_S[lane];
+    registers.P = status;
+    registers.PC = _reg_PC[lane];
+}
+
+uint64_t Batch::ticks(int lane) const
+{
+    return _ticks[lane];
+}
+
+const Batch::Occupancy_t &Batch::occupancy() const
+{
+    return _occupancy;
+}
+
+void Batch::report(std::ostream &out) const
+{
+    const Occupancy_t &o = _occupancy;
+    uint64_t steps = o.vectorLanes + o.scalarSteps;
+    std::streamsize precision = out.precision();
+
+    out << std::fixed << std::setprecision(1)
+        << "Instructions: " << steps << ", in groups: "
+        << (steps ? 100.0 * o.vectorLanes / steps : 0.0) << "%" << std::endl
+        << "Groups: " << o.vectorSteps << ", lanes in use: "
+        << (o.vectorSteps ? 100.0 * o.vectorLanes / (o.vectorSteps * _lanes) : 0.0) << "%"
+        << std::endl << std::defaultfloat << std::setprecision(precision);
+}
+
+bool Batch::load(code::AddressingKind_t mode, uint16_t address)
+{
+    switch (mode) {
+        case code::Immediate:
+            std::fill(_operand.begin(), _operand.end(), (uint8_t)address);
+            return true;
+
+        case code::ZeroPage:
+        case code::Absolute:
+            if (address < RandomAccessMemory::RamUpperBound) {
+                const uint8_t *memory = _ram.lanes(address);
+                std::copy(memory, memory + _lanes, _operand.begin());
+                return true;
+            }
+            if (address >= ReadOnlyMemory::RomLowerBankBase) {
+                uint8_t data;
+                _mbus.peek(address, data);
+                std::fill(_operand.begin(), _operand.end(), data);
+                return true;
+            }
+            return false;
+
+        default:
+            return false;
+    }
+}
+
+uint8_t *Batch::target(code::AddressingKind_t mode, uint16_t address)
+{
+    if (mode != code::ZeroPage && mode != code::Absolute)
+        return nullptr;
+
+    if (address >= RandomAccessMemory::RamUpperBound)
+        return nullptr;
+
+    return _ram.lanes(address);
+}
+
+LANE_LOOPS bool Batch::vector(const uint8_t *mask, uint16_t pc)
+{
+    // Code in RAM may differ between the lanes
+    if (pc < ReadOnlyMemory::RomLowerBankBase)
+        return false;
+
+    uint8_t opcode, low, high;
+    _mbus.peek(pc, opcode);
+    _mbus.peek(pc + 1, low);
+    _mbus.peek(pc + 2, high);
+
+    const Operation_t *operation = OperationSet[opcode];
+    const code::AddressingKind_t mode = operation->mode->kind;
+    const uint16_t address = mode == code::Immediate || mode == code::ZeroPage || mode == code::Relative
+        ? low : (uint16_t)(low | high << 8);
+    const uint16_t next = pc + 1 + operandsOf(mode);
+
+    const int n = _lanes;
+    uint8_t *A = _reg_A.data(), *X = _reg_X.data(), *Y = _reg_Y.data();
+    uint8_t *N = _flag_N.data(), *Z = _flag_Z.data(), *C = _flag_C.data(), *V = _flag_V.data();
+    const uint8_t *M = _operand.data();
+
+    // Register loaded from another one plus a delta, N and Z set
+    auto transfer = [&] (uint8_t *to, const uint8_t *from, uint8_t delta) {
+        for (int l = 0; l < n; ++l) {
+            uint8_t value = from[l] + delta;
+            to[l] = blend(mask[l], value, to[l]);
+            N[l] = blend(mask[l], value, N[l]);
+            Z[l] = blend(mask[l], value, Z[l]);
+        }
+    };
+
+    // Register compared to the operand
+    auto compare = [&] (const uint8_t *reg) {
+        for (int l = 0; l < n; ++l) {
+            uint8_t value = reg[l] - M[l];
+            N[l] = blend(mask[l], value, N[l]);
+            Z[l] = blend(mask[l], value, Z[l]);
+            C[l] = blend(mask[l], reg[l] >= M[l], C[l]);
+        }
+    };
+
+    // Memory plus a delta, N and Z set
+    auto step = [&] (uint8_t *memory, uint8_t delta) {
+        for (int l = 0; l < n; ++l) {
+            uint8_t value = memory[l] + delta;
+            memory[l] = blend(mask[l], value, memory[l]);
+            N[l] = blend(mask[l], value, N[l]);
+            Z[l] = blend(mask[l], value, Z[l]);
+        }
+    };
+
+    // Branch taken by the lanes whose flag is set, or cleared
+    auto branch = [&] (const uint8_t *flag, uint8_t bits, bool set) {
+        uint16_t target = next + (int8_t)low;
+        for (int l = 0; l < n; ++l) {
+            bool taken = ((flag[l] & bits) != 0) == set;
+            _reg_PC[l] = mask[l] ? (taken ? target : next) : _reg_PC[l];
+        }
+    };
+
+    bool branched = false;
+    uint8_t *memory = nullptr;
+
+    switch (operation->type->kind) {
+        case code::LDA: case code::LDX: case code::LDY:
+        case code::AND: case code::ORA: case code::EOR:
+        case code::ADC: case code::SBC:
+        case code::CMP: case code::CPX: case code::CPY:
+            if (!load(mode, address))
+                return false;
+            break;
+        case code::STA: case code::STX: case code::STY:
+        case code::INC: case code::DEC:
+            if (!(memory = target(mode, address)))
+                return false;
+            break;
+        default:
+            break;
+    }
+
+    switch (operation->type->kind) {
+        case code::LDA: transfer(A, M, 0); break;
+        case code::LDX: transfer(X, M, 0); break;
+        case code::LDY: transfer(Y, M, 0); break;
+
+        case code::TAX: transfer(X, A, 0); break;
+        case code::TAY: transfer(Y, A, 0); break;
+        case code::TXA: transfer(A, X, 0); break;
+        case code::TYA: transfer(A, Y, 0); break;
+
+        case code::INX: transfer(X, X, 1); break;
+        case code::INY: transfer(Y, Y, 1); break;
+        case code::DEX: transfer(X, X, 0xff); break;
+        case code::DEY: transfer(Y, Y, 0xff); break;
+
+        case code::STA:
+            for (int l = 0; l < n; ++l)
+                memory[l] = blend(mask[l], A[l], memory[l]);
+            break;
+        case code::STX:
+            for (int l = 0; l < n; ++l)
+                memory[l] = blend(mask[l], X[l], memory[l]);
+            break;
+        case code::STY:
+            for (int l = 0; l < n; ++l)
+                memory[l] = blend(mask[l], Y[l], memory[l]);
+            break;
+
+        case code::INC: step(memory, 1); break;
+        case code::DEC: step(memory, 0xff); break;
+
+        case code::AND:
+            for (int l = 0; l < n; ++l)
+                _operand[l] = A[l] & M[l];
+            transfer(A, M, 0);
+            break;
+        case code::ORA:
+            for (int l = 0; l < n; ++l)
+                _operand[l] = A[l] | M[l];
+            transfer(A, M, 0);
+            break;
+        case code::EOR:
+            for (int l = 0; l < n; ++l)
+                _operand[l] = A[l] ^ M[l];
+            transfer(A, M, 0);
+            break;
+
+        case code::SBC:
+            // A - M - !C is A + ~M + C, with the same carry and overflow
+            for (int l = 0; l < n; ++l)
+                _operand[l] = ~M[l];
+            // fall through
+        case code::ADC:
+            for (int l = 0; l < n; ++l) {
+                uint16_t sum = A[l] + M[l] + C[l];
+                uint8_t value = sum;
+                V[l] = blend(mask[l], (A[l] ^ value) & (M[l] ^ value), V[l]);
+                C[l] = blend(mask[l], sum >> 8, C[l]);
+                A[l] = blend(mask[l], value, A[l]);
+                N[l] = blend(mask[l], value, N[l]);
+                Z[l] = blend(mask[l], value, Z[l]);
+            }
+            break;
+
+        case code::CMP: compare(A); break;
+        case code::CPX: compare(X); break;
+        case code::CPY: compare(Y); break;
+
+        case code::CLC:
+            for (int l = 0; l < n; ++l)
+                C[l] = blend(mask[l], 0, C[l]);
+            break;
+        case code::SEC:
+            for (int l = 0; l < n; ++l)
+                C[l] = blend(mask[l], 1, C[l]);
+            break;
+        case code::CLV:
+            for (int l = 0; l < n; ++l)
+                V[l] = blend(mask[l], 0, V[l]);
+            break;
+        case code::NOP:
+            break;
+
+        case code::BCC: branch(C, 0x01, false); branched = true; break;
+        case code::BCS: branch(C, 0x01, true);  branched = true; break;
+        case code::BNE: branch(Z, 0xff, true);  branched = true; break;
+        case code::BEQ: branch(Z, 0xff, false); branched = true; break;
+        case code::BPL: branch(N, 0x80, false); branched = true; break;
+        case code::BMI: branch(N, 0x80, true);  branched = true; break;
+        case code::BVC: branch(V, 0x80, false); branched = true; break;
+        case code::BVS: branch(V, 0x80, true);  branched = true; break;
+
+        case code::JMP:
+            if (mode != code::Absolute)
+                return false;
+            for (int l = 0; l < n; ++l)
+                _reg_PC[l] = mask[l] ? address : _reg_PC[l];
+            branched = true;
+            break;
+
+        default:
+            // Stack, indexed and shift instructions, and interrupts
+            return false;
+    }
+
+    if (!branched) {
+        for (int l = 0; l < n; ++l)
+            _reg_PC[l] = mask[l] ? next : _reg_PC[l];
+    }
+
+    const uint64_t ticks = 1 + operation->cycles;
+    for (int l = 0; l < n; ++l)
+        _ticks[l] += ticks & -(uint64_t)(mask[l] & 1);
+
+    return true;
+}
+
+void Batch::scalar(int lane)
+{
+    State_t state;
+    _cpu.save(state);
+
+    state.cycles = _ticks[lane];
+    state.skip = 0;
+    state.PC = _reg_PC[lane];
+    state.A = _reg_A[lane];
+    state.X = _reg_X[lane];
+    state.Y = _reg_Y[lane];
+    state.S = _reg_S[lane];
+    state.P = _reg_P[lane];
+    state.flags = { _flag_N[lane], _flag_Z[lane], _flag_C[lane], _flag_V[lane] };
+
+    _ram.setLane(lane);
+    _cpu.restore(state);
+    _cpu.step();
+    _cpu.save(state);
+
+    _ticks[lane] = state.cycles + state.skip;
+    _reg_PC[lane] = state.PC;
+    _reg_A[lane] = state.A;
+    _reg_X[lane] = state.X;
+    _reg_Y[lane] = state.Y;
+    _reg_S[lane] = state.S;
+    _reg_P[lane] = state.P;
+    _flag_N[lane] = state.flags.N;
+    _flag_Z[lane] = state.flags.Z;
+    _flag_C[lane] = state.flags.C;
+    _flag_V[lane] = state.flags.V;
+}
+
+} // namespace cpu
+} // namespace tones
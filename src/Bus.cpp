@@ -1,58 +1,256 @@
 
+#include <algorithm>
+#include <cstring>
+
 #include "Bus.h"
+#include "Log.h"
 
 namespace tones {
 
 /* Accessible */
 
+Accessible::Accessible() : _bus(nullptr) {}
+
 void Accessible::attach(Bus &bus)
 {
-    _bus = &bus;
-    _bus->attach(this);
+    if (bus.attach(this))
+        _bus = &bus;
 }
 
 void Accessible::detach()
 {
-    _bus->detach(this);
-    _bus = nullptr;
+    if (_bus) {
+        _bus->detach(this);
+        _bus = nullptr;
+    }
+}
+
+void Accessible::peek(uint16_t address, uint8_t &buffer) const
+{
+    read(address, buffer);
+}
+
+bool Accessible::stable(uint16_t) const
+{
+    return false;
 }
 
-void Accessible::read(uint8_t &buffer) const
+void Accessible::transfer(uint16_t address, const uint8_t *data, int length)
 {
-    if (contains(_bus->address()))
-        read(_bus->address(), buffer);
+    for (int i = 0; i < length; ++i)
+        write(address, data[i]);
 }
 
-void Accessible::write(uint8_t data)
+void Accessible::map(uint16_t, Page_t &)
 {
-    if (contains(_bus->address()))
-        write(_bus->address(), data);
+    /* Accessed by read() and write() only */
+}
+
+void Accessible::remap()
+{
+    if (_bus)
+        _bus->remap(this);
 }
 
 /* Bus */
 
+Bus::Bus()
+    : _address(0)
+    , _generation(0)
+#ifdef TONES_BUS_TRACE
+    , _tracer(nullptr)
+    , _traceId(0)
+#endif
+{
+    _pages.fill({ nullptr, nullptr, nullptr, 0, 0 });
+    remap();
+}
+
 uint16_t Bus::address() const
 {
     return _address;
 }
 
-void Bus::read(uint16_t address, uint8_t &buffer)
+void Bus::readDevice(uint16_t address, uint8_t &buffer)
 {
     _address = address;
-    for (auto it = _devices.begin(); it != _devices.end(); ++it)
-        (*it)->read(buffer);
+
+    const Page_t &page = _pages[address >> PageShift];
+    Accessible *device = page.device ? page.device : decode(address);
+    if (device)
+        device->read(address, buffer);
+
+    if (page.watch)
+        watched(address, buffer, Access::Read);
 }
 
-void Bus::write(uint16_t address, uint8_t data)
+void Bus::writeDevice(uint16_t address, uint8_t data)
 {
     _address = address;
-    for (auto it = _devices.begin(); it != _devices.end(); ++it)
-        (*it)->write(data);
+
+    const Page_t &page = _pages[address >> PageShift];
+    Accessible *device = page.device ? page.device : decode(address);
+    if (device)
+        device->write(address, data);
+
+    if (page.watch)
+        watched(address, data, Access::Write);
+}
+
+void Bus::peek(uint16_t address, uint8_t &buffer) const
+{
+    const Page_t &page = _pages[address >> PageShift];
+    if (page.rbase) {
+        buffer = page.rbase[address & page.mask];
+        return;
+    }
+
+    const Accessible *device = page.device ? page.device : decode(address);
+    if (device)
+        device->peek(address, buffer);
+}
+
+bool Bus::stable(uint16_t address) const
+{
+    const Page_t &page = _pages[address >> PageShift];
+    if (page.rbase)
+        return true;
+
+    // Every read is reported
+    if (page.watch & static_cast<uint8_t>(Access::Read))
+        return false;
+
+    // Open bus keeps what was read last time
+    const Accessible *device = page.device ? page.device : decode(address);
+    return device ? device->stable(address) : true;
+}
+
+void Bus::dump(uint16_t address, uint8_t *buffer, int length) const
+{
+    while (length > 0) {
+        const Page_t &page = _pages[address >> PageShift];
+        int count = std::min(length, PageSize - (address & PageMask));
+
+        if (page.rbase && page.mask >= PageMask) {
+            // Contiguous in host memory within a page
+            memcpy(buffer, page.rbase + (address & page.mask), count);
+        } else {
+            for (int i = 0; i < count; ++i)
+                peek(address + i, buffer[i]);
+        }
+
+        address += count;
+        buffer += count;
+        length -= count;
+    }
+}
+
+void Bus::transfer(uint16_t address, const uint8_t *data, int length)
+{
+    const Page_t &page = _pages[address >> PageShift];
+    if (page.wbase || page.watch) {
+        for (int i = 0; i < length; ++i)
+            write(address, data[i]);
+        return;
+    }
+
+    _address = address;
+
+    Accessible *device = page.device ? page.device : decode(address);
+    if (device)
+        device->transfer(address, data, length);
+
+#ifdef TONES_BUS_TRACE
+    if (_tracer) {
+        for (int i = 0; i < length; ++i)
+            _tracer->record(_traceId, address, data[i], static_cast<uint8_t>(Access::Write));
+    }
+#endif
+}
+
+const uint8_t *Bus::memory(uint16_t address) const
+{
+    const Page_t &page = _pages[address >> PageShift];
+    if (!page.rbase || page.mask < PageMask)
+        return nullptr;
+
+#ifdef TONES_BUS_TRACE
+    // Reads of it would be missing from the trace
+    if (_tracer)
+        return nullptr;
+#endif
+
+    return page.rbase + (address & page.mask);
+}
+
+void Bus::watch(uint16_t address, Access access)
+{
+    if (_watches.empty())
+        _watches.resize(AddressSpace, 0);
+
+    _watches[address] |= static_cast<uint8_t>(access);
+
+    int page = address >> PageShift;
+    _pages[page].watch |= static_cast<uint8_t>(access);
+    map(page, _pages[page].device);
 }
 
-void Bus::attach(Accessible *device)
+void Bus::unwatch(uint16_t address, Access access)
 {
+    if (_watches.empty())
+        return;
+
+    _watches[address] &= ~static_cast<uint8_t>(access);
+
+    // Kinds still watched by other addresses of the page
+    int page = address >> PageShift;
+    uint16_t base = page << PageShift;
+    _pages[page].watch = 0;
+    for (int offset = 0; offset < PageSize; ++offset)
+        _pages[page].watch |= _watches[base + offset];
+
+    map(page, _pages[page].device);
+}
+
+void Bus::unwatch()
+{
+    _watches.clear();
+    for (int page = 0; page < PageCount; ++page) {
+        if (_pages[page].watch) {
+            _pages[page].watch = 0;
+            map(page, _pages[page].device);
+        }
+    }
+}
+
+void Bus::setWatcher(Watcher watcher)
+{
+    _watcher = watcher;
+}
+
+#ifdef TONES_BUS_TRACE
+void Bus::setTracer(trace::RingBuffer *tracer, uint8_t bus)
+{
+    _tracer = tracer;
+    _traceId = bus;
+}
+#endif
+
+bool Bus::attach(Accessible *device)
+{
+    for (int addr = 0; addr < AddressSpace; ++addr) {
+        if (!device->contains(addr))
+            continue;
+
+        if (_pages[addr >> PageShift].device || decode(addr)) {
+            LOG_ERROR() << "Device overlaps at address 0x" << std::hex << addr;
+            return false;
+        }
+    }
+
     _devices.push_back(device);
+    remap();
+    return true;
 }
 
 void Bus::detach(Accessible *device)
@@ -63,6 +261,81 @@ void Bus::detach(Accessible *device)
             break;
         }
     }
+
+    remap();
+}
+
+void Bus::remap()
+{
+    for (int page = 0; page < PageCount; ++page) {
+        map(page, nullptr);
+        _shared[page].clear();
+    }
+
+    for (auto it = _devices.begin(); it != _devices.end(); ++it) {
+        for (int page = 0; page < PageCount; ++page) {
+            int count = coverage(*it, page);
+            if (count == PageSize) {
+                map(page, *it);
+            } else if (count) {
+                _shared[page].push_back(*it);
+            }
+        }
+    }
+}
+
+void Bus::remap(Accessible *device)
+{
+    for (int page = 0; page < PageCount; ++page) {
+        if (_pages[page].device == device)
+            map(page, device);
+    }
+}
+
+void Bus::map(int page, Accessible *device)
+{
+    ++_generation;
+
+    Page_t &entry = _pages[page];
+    entry = { device, nullptr, nullptr, 0, entry.watch };
+
+    if (device)
+        device->map(page << PageShift, entry);
+
+    if (entry.watch & static_cast<uint8_t>(Access::Read))
+        entry.rbase = nullptr;
+
+    if (entry.watch & static_cast<uint8_t>(Access::Write))
+        entry.wbase = nullptr;
+}
+
+Accessible *Bus::decode(uint16_t address) const
+{
+    auto &devices = _shared[address >> PageShift];
+    for (auto it = devices.begin(); it != devices.end(); ++it) {
+        if ((*it)->contains(address))
+            return *it;
+    }
+
+    return nullptr;
+}
+
+void Bus::watched(uint16_t address, uint8_t data, Access access)
+{
+    if (_watcher && (_watches[address] & static_cast<uint8_t>(access)))
+        _watcher(address, data, access);
+}
+
+int Bus::coverage(const Accessible *device, int page)
+{
+    int count = 0;
+    uint16_t base = page << PageShift;
+    for (int offset = 0; offset < PageSize; ++offset) {
+        if (device->contains(base + offset))
+            ++count;
+    }
+
+    return count;
 }
 
 } // namespace tones
@@ -84,6 +84,14 @@ int iNESReader::mapper() const
     return (_header.ctrl2 & 0xf0) | ((_header.ctrl1 & 0xf0) >> 4);
 }
 
+Mirroring_t iNESReader::mirroring() const
+{
+    if (_header.ctrl1 & 0x08)
+        return Mirroring::FourScreen;
+
+    return _header.ctrl1 & 0x01 ? Mirroring::Vertical : Mirroring::Horizontal;
+}
+
 bool iNESReader::validate(const Header &header)
 {
     if (header.magic != MagicNumber) {
@@ -138,6 +146,26 @@ const std::vector<uint8_t> &Cartridge::chrRom() const
     return _reader->chrRom();
 }
 
+Mirroring_t Cartridge::mirroring() const
+{
+    return _reader->mirroring();
+}
+
+int Cartridge::mapper() const
+{
+    return _reader->mapper();
+}
+
+void Cartridge::patch(const Cheat_t &cheat)
+{
+    _prom->patch(cheat);
+}
+
+void Cartridge::unpatch()
+{
+    _prom->unpatch();
+}
+
 /* CartridgeFactory */
 
 CartridgePtr CartridgeFactory::createCartridge(const std::string &path)
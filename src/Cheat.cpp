@@ -0,0 +1,101 @@
+
+#include "Cheat.h"
+
+#include <cctype>
+#include <cstdlib>
+
+namespace tones {
+namespace cheat {
+
+static const char *GameGenieLetters = "APZLGITYEOXUKSVN";
+
+static int letter(char c)
+{
+    c = std::toupper(c);
+    for (int i = 0; i < 16; ++i) {
+        if (GameGenieLetters[i] == c)
+            return i;
+    }
+
+    return -1;
+}
+
+static bool hex(const std::string &text, int digits, int &value)
+{
+    if ((int)text.size() != digits)
+        return false;
+
+    for (auto c : text) {
+        if (!std::isxdigit(c))
+            return false;
+    }
+
+    value = std::strtol(text.c_str(), nullptr, 16);
+    return true;
+}
+
+bool decodeGameGenie(const std::string &code, Cheat_t &cheat)
+{
+    int n[8];
+    int length = code.size();
+
+    if (length != 6 && length != 8)
+        return false;
+
+    for (int i = 0; i < length; ++i) {
+        if ((n[i] = letter(code[i])) < 0)
+            return false;
+    }
+
+    cheat.address = 0x8000
+                  | ((n[3] & 7) << 12)
+                  | ((n[5] & 7) << 8) | ((n[4] & 8) << 8)
+                  | ((n[2] & 7) << 4) | ((n[1] & 8) << 4)
+                  |  (n[4] & 7)       |  (n[3] & 8);
+
+    // The bit 3 of the value is in the last letter
+    cheat.value = ((n[1] & 7) << 4) | ((n[0] & 8) << 4) | (n[0] & 7)
+                | (n[length - 1] & 8);
+
+    cheat.compared = length == 8;
+    cheat.compare = 0;
+    if (cheat.compared) {
+        cheat.compare = ((n[7] & 7) << 4) | ((n[6] & 8) << 4) | (n[6] & 7)
+                      | (n[5] & 8);
+    }
+
+    return true;
+}
+
+bool decodeRaw(const std::string &code, Cheat_t &cheat)
+{
+    int address, value, compare = 0;
+
+    auto colon = code.find(':');
+    if (colon == std::string::npos)
+        return false;
+
+    auto question = code.find('?');
+    bool compared = question != std::string::npos && question < colon;
+
+    if (!hex(code.substr(0, compared ? question : colon), 4, address) ||
+        !hex(code.substr(colon + 1), 2, value))
+        return false;
+
+    if (compared && !hex(code.substr(question + 1, colon - question - 1), 2, compare))
+        return false;
+
+    cheat.address = address;
+    cheat.value = value;
+    cheat.compare = compare;
+    cheat.compared = compared;
+    return true;
+}
+
+bool decode(const std::string &code, Cheat_t &cheat)
+{
+    return decodeGameGenie(code, cheat) || decodeRaw(code, cheat);
+}
+
+} // namespace cheat
+} // namespace tones
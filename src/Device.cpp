@@ -1,10 +1,17 @@
 
+#include <cstring>
+
 #include "Device.h"
 
 namespace tones {
 
 /* RandomAccessMemory */
 
+RandomAccessMemory::RandomAccessMemory()
+    : _memory()
+{
+}
+
 bool RandomAccessMemory::contains(uint16_t addr) const
 {
     return addr < RamUpperBound;
@@ -20,6 +27,13 @@ void RandomAccessMemory::write(uint16_t address, uint8_t data)
     _memory[address & RamMask] = data;
 }
 
+void RandomAccessMemory::map(uint16_t, Page_t &page)
+{
+    page.rbase = _memory.data();
+    page.wbase = _memory.data();
+    page.mask  = RamMask;
+}
+
 /* SaveRandomAccessMemory */
 
 bool SaveRandomAccessMemory::contains(uint16_t addr) const
@@ -37,10 +51,22 @@ void SaveRandomAccessMemory::write(uint16_t address, uint8_t data)
     _memory[address & SramMask] = data;
 }
 
+void SaveRandomAccessMemory::map(uint16_t, Page_t &page)
+{
+    page.rbase = _memory.data();
+    page.wbase = _memory.data();
+    page.mask  = SramMask;
+}
+
 /* ReadOnlyMemory */
 
 ReadOnlyMemory::ReadOnlyMemory(const std::vector<uint8_t> &memory)
-    : _memory(memory) {}
+    : _memory(memory)
+{
+    // The PRG data, until pages are mapped
+    for (int index = 0; index < RomPageCount; ++index)
+        _pages[index] = _memory.data() + (index << PageShift);
+}
 
 bool ReadOnlyMemory::contains(uint16_t addr) const
 {
@@ -49,7 +75,7 @@ bool ReadOnlyMemory::contains(uint16_t addr) const
 
 void ReadOnlyMemory::read(uint16_t address, uint8_t &buffer) const
 {
-    buffer = _memory[address & RomMask];
+    buffer = _pages[(address & RomMask) >> PageShift][address & PageMask];
 }
 
 void ReadOnlyMemory::write(uint16_t address, uint8_t data)
@@ -57,8 +83,55 @@ void ReadOnlyMemory::write(uint16_t address, uint8_t data)
     /* Just do nothing at all*/
 }
 
+void ReadOnlyMemory::map(uint16_t address, Page_t &page)
+{
+    int index = (address & RomMask) >> PageShift;
+    const uint8_t *bank = _memory.data() + (address & RomMask);
+
+    auto it = _overlays.find(index);
+    if (it != _overlays.end()) {
+        // Patch the bytes holding the compare values, from the
+        // bank mapped right now
+        Overlay_t &overlay = it->second;
+        memcpy(overlay.memory.data(), bank, PageSize);
+        for (auto &cheat : overlay.cheats) {
+            int offset = cheat.address & PageMask;
+            if (!cheat.compared || bank[offset] == cheat.compare)
+                overlay.memory[offset] = cheat.value;
+        }
+
+        bank = overlay.memory.data();
+    }
+
+    _pages[index] = bank;
+
+    page.rbase = bank;
+    page.mask  = PageMask; // writes go to write(), for mappers
+}
+
+void ReadOnlyMemory::patch(const Cheat_t &cheat)
+{
+    if (!contains(cheat.address))
+        return;
+
+    int index = (cheat.address & RomMask) >> PageShift;
+    _overlays[index].cheats.push_back(cheat);
+    remap();
+}
+
+void ReadOnlyMemory::unpatch()
+{
+    _overlays.clear();
+    remap();
+}
+
 /* VideoRandomAccessMemory */
 
+VideoRandomAccessMemory::VideoRandomAccessMemory()
+{
+    setMirroring(Mirroring::Vertical);
+}
+
 bool VideoRandomAccessMemory::contains(uint16_t addr) const
 {
     return addr >= VramLowerBound && addr < VramUpperBound;
@@ -66,18 +139,60 @@ bool VideoRandomAccessMemory::contains(uint16_t addr) const
 
 void VideoRandomAccessMemory::read(uint16_t address, uint8_t &buffer) const
 {
-    buffer = _memory[address & VramMask];
+    buffer = _tables[slot(address)][address & TableMask];
 }
 
 void VideoRandomAccessMemory::write(uint16_t address, uint8_t data)
 {
-    _memory[address & VramMask] = data;
+    _tables[slot(address)][address & TableMask] = data;
+}
+
+void VideoRandomAccessMemory::map(uint16_t address, Page_t &page)
+{
+    page.rbase = _tables[slot(address)];
+    page.wbase = _tables[slot(address)];
+    page.mask  = TableMask;
+}
+
+void VideoRandomAccessMemory::setMirroring(Mirroring_t mirroring)
+{
+    uint8_t *lower = _memory.data();
+    uint8_t *upper = _memory.data() + TableSize;
+
+    switch (mirroring) {
+        case Mirroring::Horizontal:
+            _tables = {{ lower, lower, upper, upper }};
+            break;
+        case Mirroring::Vertical:
+            _tables = {{ lower, upper, lower, upper }};
+            break;
+        case Mirroring::SingleLower:
+            _tables = {{ lower, lower, lower, lower }};
+            break;
+        case Mirroring::SingleUpper:
+            _tables = {{ upper, upper, upper, upper }};
+            break;
+        case Mirroring::FourScreen:
+            _tables = {{ lower, upper, upper + TableSize, upper + 2 * TableSize }};
+            break;
+    }
+
+    remap();
+}
+
+inline int VideoRandomAccessMemory::slot(uint16_t address) const
+{
+    return (address >> TableShift) & (TableCount - 1);
 }
 
 /* PatternTalbe */
 
 PatternTables::PatternTables(const std::vector<uint8_t> &memory)
-    : _memory(memory) {}
+    : _memory(memory)
+{
+    for (int i = 0; i < SlotCount; ++i)
+        _slots[i] = _memory.data() + i * SlotSize;
+}
 
 bool PatternTables::contains(uint16_t addr) const
 {
@@ -86,7 +201,7 @@ bool PatternTables::contains(uint16_t addr) const
 
 void PatternTables::read(uint16_t address, uint8_t &buffer) const
 {
-    buffer = _memory[address];
+    buffer = _slots[address >> SlotShift][address & SlotMask];
 }
 
 void PatternTables::write(uint16_t address, uint8_t data)
@@ -94,4 +209,10 @@ void PatternTables::write(uint16_t address, uint8_t data)
     /* TODO */
 }
 
+void PatternTables::map(uint16_t address, Page_t &page)
+{
+    page.rbase = _slots[address >> SlotShift];
+    page.mask  = SlotMask;
+}
+
 } // namespace tones
\ No newline at end of file
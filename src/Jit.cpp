@@ -0,0 +1,1228 @@
+#include "Jit.h"
+
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#ifdef TONES_JIT
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "Log.h"
+#include "MicroProcessor.h"
+
+namespace tones {
+namespace jit {
+
+#ifdef TONES_JIT
+
+const int CodeAlignment = 16;
+
+/* Bytes of code at most, for the prologue and the epilogue of
+ * a block, and for each instruction in it */
+const int BlockCodeSize = 128;
+const int InstructionCodeSize = 256;
+
+const int OperandsSize = sizeof(cpu::BlockStep_t::operands);
+
+/* Registers of x86-64 */
+enum Register {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+    NoRegister = -1
+};
+
+/* The state of the CPU, and the registers of the 6502 held
+ * through a block, zero extended, all of them callee-saved */
+const int RegState = RBX;
+const int RegA = R12;
+const int RegX = R13;
+const int RegY = R14;
+const int RegN = R15;
+const int RegZ = RBP;
+
+/* Slots of the stack frame of a block */
+const int FrameCpu = 0;      // the CPU the block runs on
+const int FrameTicks = 8;    // ticks of the steps called
+const int FrameAddress = 16; // address of a read-modify-write
+const int FrameEntry = 24;   // PC the block is entered at
+const int FrameSize = 40;    // aligns the calls, after the pushes
+
+/* Condition codes */
+const int CondEqual = 0x4;
+const int CondNotEqual = 0x5;
+const int CondAboveEqual = 0x3;
+
+/* Operations of the ALU, as their codes for r/m, r */
+const uint8_t OpAdd = 0x01;
+const uint8_t OpOr  = 0x09;
+const uint8_t OpAnd = 0x21;
+const uint8_t OpSub = 0x29;
+const uint8_t OpXor = 0x31;
+const uint8_t OpCmp = 0x39;
+
+/* Extensions of the op codes with an immediate */
+const int ExtAdd = 0;
+const int ExtOr  = 1;
+const int ExtAnd = 4;
+const int ExtSub = 5;
+const int ExtXor = 6;
+const int ExtCmp = 7;
+const int ExtShl = 4;
+const int ExtShr = 5;
+
+/* Offsets in the state of the CPU */
+const int StatePC = offsetof(cpu::State_t, PC);
+const int StateA  = offsetof(cpu::State_t, A);
+const int StateX  = offsetof(cpu::State_t, X);
+const int StateY  = offsetof(cpu::State_t, Y);
+const int StateS  = offsetof(cpu::State_t, S);
+const int StateP  = offsetof(cpu::State_t, P);
+const int StateN  = offsetof(cpu::State_t, flags) + offsetof(cpu::Flags_t, N);
+const int StateZ  = offsetof(cpu::State_t, flags) + offsetof(cpu::Flags_t, Z);
+const int StateC  = offsetof(cpu::State_t, flags) + offsetof(cpu::Flags_t, C);
+const int StateV  = offsetof(cpu::State_t, flags) + offsetof(cpu::Flags_t, V);
+const int StateDBB = offsetof(cpu::State_t, DBB);
+
+/* Offsets in an entry of the page table */
+const int PageRead  = offsetof(Page_t, rbase);
+const int PageWrite = offsetof(Page_t, wbase);
+const int PageMirror = offsetof(Page_t, mask);
+
+//! A memory operand, [base + index + disp]
+typedef struct Memory {
+    int base;
+    int index;
+    int32_t disp;
+} Memory_t;
+
+static inline Memory_t at(int base, int32_t disp = 0)
+{
+    return { base, NoRegister, disp };
+}
+
+static inline Memory_t at(int base, int index, int32_t disp)
+{
+    return { base, index, disp };
+}
+
+/**
+ * @brief Appends machine code to a buffer
+ *
+ * Only the forms the translator needs. The operations on bytes
+ * always take a REX prefix, for SPL, BPL, SIL, DIL and R8B to
+ * R15B to be addressed instead of AH to BH
+ */
+class Assembler
+{
+
+public:
+
+    Assembler(uint8_t *code) : _code(code), _size(0) {}
+
+    int size() const
+    {
+        return _size;
+    }
+
+    void bytes(std::initializer_list<uint8_t> data)
+    {
+        for (uint8_t byte : data)
+            _code[_size++] = byte;
+    }
+
+    void imm8(uint8_t value)
+    {
+        _code[_size++] = value;
+    }
+
+    void imm16(uint16_t value)
+    {
+        memcpy(_code + _size, &value, sizeof(value));
+        _size += sizeof(value);
+    }
+
+    void imm32(int32_t value)
+    {
+        memcpy(_code + _size, &value, sizeof(value));
+        _size += sizeof(value);
+    }
+
+    void imm64(uint64_t value)
+    {
+        memcpy(_code + _size, &value, sizeof(value));
+        _size += sizeof(value);
+    }
+
+    /* Moves */
+
+    //! movzx r32, byte [m]
+    void load8(int dst, const Memory_t &m) { emit({ 0x0f, 0xb6 }, dst, m); }
+
+    //! movzx r32, word [m]
+    void load16(int dst, const Memory_t &m) { emit({ 0x0f, 0xb7 }, dst, m); }
+
+    //! mov r32, [m]
+    void load32(int dst, const Memory_t &m) { emit({ 0x8b }, dst, m); }
+
+    //! mov r64, [m]
+    void load64(int dst, const Memory_t &m) { emit({ 0x8b }, dst, m, true); }
+
+    //! mov byte [m], r8
+    void store8(const Memory_t &m, int src) { emit({ 0x88 }, src, m, false, true); }
+
+    //! mov word [m], r16
+    void store16(const Memory_t &m, int src)
+    {
+        bytes({ 0x66 });
+        emit({ 0x89 }, src, m);
+    }
+
+    //! mov [m], r64
+    void store64(const Memory_t &m, int src) { emit({ 0x89 }, src, m, true); }
+
+    //! mov byte [m], imm8
+    void storeImm8(const Memory_t &m, uint8_t value) { emit({ 0xc6 }, 0, m); imm8(value); }
+
+    //! mov word [m], imm16
+    void storeImm16(const Memory_t &m, uint16_t value)
+    {
+        bytes({ 0x66 });
+        emit({ 0xc7 }, 0, m);
+        imm16(value);
+    }
+
+    //! mov dword [m], imm32
+    void storeImm32(const Memory_t &m, int32_t value) { emit({ 0xc7 }, 0, m); imm32(value); }
+
+    //! mov r32, r32
+    void mov32(int dst, int src) { emit({ 0x89 }, src, dst); }
+
+    //! movzx r32, r8
+    void movzx8(int dst, int src) { emit({ 0x0f, 0xb6 }, dst, src, false, true); }
+
+    //! movzx r32, r16
+    void movzx16(int dst, int src) { emit({ 0x0f, 0xb7 }, dst, src); }
+
+    //! mov r32, imm32
+    void set32(int dst, int32_t value)
+    {
+        rex(false, 0, NoRegister, dst, false);
+        bytes({ (uint8_t)(0xb8 | (dst & 7)) });
+        imm32(value);
+    }
+
+    //! mov r64, imm64
+    void set64(int dst, const void *value)
+    {
+        rex(true, 0, NoRegister, dst, false);
+        bytes({ (uint8_t)(0xb8 | (dst & 7)) });
+        imm64((uint64_t)value);
+    }
+
+    //! lea r32, [m]
+    void lea32(int dst, const Memory_t &m) { emit({ 0x8d }, dst, m); }
+
+    //! lea r64, [rip + disp], returns where to patch the disp
+    int leaRip(int dst)
+    {
+        rex(true, dst, NoRegister, 0, false);
+        bytes({ 0x8d, (uint8_t)((dst & 7) << 3 | 0x05) });
+        imm32(0);
+        return _size;
+    }
+
+    /* Arithmetic */
+
+    //! op r32, r32
+    void alu32(uint8_t op, int dst, int src) { emit({ op }, src, dst); }
+
+    //! op r32, imm
+    void aluImm32(int ext, int dst, int32_t value)
+    {
+        if (value >= -128 && value <= 127) {
+            emit({ 0x83 }, ext, dst);
+            imm8(value);
+        } else {
+            emit({ 0x81 }, ext, dst);
+            imm32(value);
+        }
+    }
+
+    //! op r64, imm8
+    void aluImm64(int ext, int dst, int8_t value) { emit({ 0x83 }, ext, dst, true); imm8(value); }
+
+    //! op byte [m], imm8
+    void aluImm8(int ext, const Memory_t &m, uint8_t value) { emit({ 0x80 }, ext, m); imm8(value); }
+
+    //! add [m], r32
+    void add32(const Memory_t &m, int src) { emit({ 0x01 }, src, m); }
+
+    //! add r64, r64
+    void add64(int dst, int src) { emit({ 0x01 }, src, dst, true); }
+
+    //! imul r32, r32, imm8
+    void imul32(int dst, int src, int8_t value) { emit({ 0x6b }, dst, src); imm8(value); }
+
+    //! shl or shr r32, imm8
+    void shift32(int ext, int dst, uint8_t count) { emit({ 0xc1 }, ext, dst); imm8(count); }
+
+    //! test r32, r32
+    void test32(int a, int b) { emit({ 0x85 }, b, a); }
+
+    //! test r64, r64
+    void test64(int a, int b) { emit({ 0x85 }, b, a, true); }
+
+    //! test r8, imm8
+    void test8(int reg, uint8_t value) { emit({ 0xf6 }, 0, reg, false, true); imm8(value); }
+
+    //! test byte [m], imm8
+    void test8(const Memory_t &m, uint8_t value) { emit({ 0xf6 }, 0, m); imm8(value); }
+
+    //! setcc byte [m]
+    void set8(int condition, const Memory_t &m) { emit({ 0x0f, (uint8_t)(0x90 | condition) }, 0, m); }
+
+    /* Control */
+
+    //! jcc or jmp rel32 forward, returns the label to bind
+    int jump(int condition = -1)
+    {
+        if (condition < 0)
+            bytes({ 0xe9 });
+        else
+            bytes({ 0x0f, (uint8_t)(0x80 | condition) });
+
+        imm32(0);
+        return _size;
+    }
+
+    //! Make a forward jump land here
+    void bind(int label)
+    {
+        patch(label, _size);
+    }
+
+    //! Set the rel32 ending at a label to reach an offset of the code
+    void patch(int label, int target)
+    {
+        int32_t disp = target - label;
+        memcpy(_code + label - sizeof(disp), &disp, sizeof(disp));
+    }
+
+    //! Call a function through RAX
+    void call(const void *function)
+    {
+        set64(RAX, function);
+        bytes({ 0xff, 0xd0 });
+    }
+
+    void push(int reg)
+    {
+        rex(false, 0, NoRegister, reg, false);
+        bytes({ (uint8_t)(0x50 | (reg & 7)) });
+    }
+
+    void pop(int reg)
+    {
+        rex(false, 0, NoRegister, reg, false);
+        bytes({ (uint8_t)(0x58 | (reg & 7)) });
+    }
+
+    void ret()
+    {
+        bytes({ 0xc3 });
+    }
+
+private:
+
+    void rex(bool wide, int reg, int index, int base, bool force)
+    {
+        uint8_t prefix = 0x40 | (wide ? 0x08 : 0) | (reg & 8 ? 0x04 : 0) |
+                         (index != NoRegister && (index & 8) ? 0x02 : 0) | (base & 8 ? 0x01 : 0);
+        if (prefix != 0x40 || force)
+            bytes({ prefix });
+    }
+
+    //! An instruction on a register, and a memory operand
+    void emit(std::initializer_list<uint8_t> opcode, int reg, const Memory_t &m,
+              bool wide = false, bool force = false)
+    {
+        rex(wide, reg, m.index, m.base, force);
+        bytes(opcode);
+
+        // No displacement at all is RIP or R13 relative instead
+        int mod = (m.disp == 0 && (m.base & 7) != RBP) ? 0 :
+                  (m.disp >= -128 && m.disp <= 127) ? 1 : 2;
+
+        if (m.index == NoRegister && (m.base & 7) != RSP) {
+            bytes({ (uint8_t)(mod << 6 | (reg & 7) << 3 | (m.base & 7)) });
+        } else {
+            int index = m.index == NoRegister ? RSP : m.index;
+            bytes({ (uint8_t)(mod << 6 | (reg & 7) << 3 | 0x04),
+                    (uint8_t)((index & 7) << 3 | (m.base & 7)) });
+        }
+
+        if (mod == 1)
+            imm8(m.disp);
+        else if (mod == 2)
+            imm32(m.disp);
+    }
+
+    //! An instruction on two registers
+    void emit(std::initializer_list<uint8_t> opcode, int reg, int rm,
+              bool wide = false, bool force = false)
+    {
+        rex(wide, reg, NoRegister, rm, force);
+        bytes(opcode);
+        bytes({ (uint8_t)(0xc0 | (reg & 7) << 3 | (rm & 7)) });
+    }
+
+private:
+
+    uint8_t *_code;
+
+    int _size;
+};
+
+//! What the code of a block works on, fixed when it is compiled
+typedef struct Target {
+    cpu::State_t *state;
+    const Page_t *pages;         // page table of the bus
+    const uint8_t *codePages;    // pages of RAM holding blocks
+    uint8_t (*read)(MicroProcessor *cpu, uint16_t address);
+    void (*write)(MicroProcessor *cpu, uint16_t address, uint8_t data);
+} Target_t;
+
+/**
+ * @brief Translates the instructions of a block
+ *
+ * Same results as the steps of the interpreter, with the same
+ * accesses to anything but memory, in the same order
+ */
+class Translator
+{
+
+public:
+
+    Translator(Assembler &as, const Target_t &target, uint16_t entry)
+        : _as(as)
+        , _target(target)
+        , _entry(entry)
+        , _ticks(0)
+    {
+    }
+
+    void prologue();
+
+    //! Translate an instruction, false if it ended the block
+    bool translate(const cpu::BlockStep_t &step, uint16_t address);
+
+    //! Return, with PC set to an address unless set already
+    void epilogue(bool setPC, uint16_t address);
+
+    //! Steps called, with the offsets of their operands to patch
+    const std::vector<std::pair<int, const cpu::BlockStep_t*>> &calls() const
+    {
+        return _calls;
+    }
+
+private:
+
+    //! Where the operand of an instruction is
+    typedef struct Location {
+        enum Kind {
+            Immediate, // the value itself
+            Host,      // host memory known when compiling
+            Bus,       // a device, at an address known when compiling
+            Indexed,   // host memory of R8, plus an index register
+            Computed   // an address in EAX, looked up when running
+        } kind;
+
+        uint8_t value;
+        uint16_t address;
+        const uint8_t *rhost;
+        uint8_t *whost;
+        int index;
+        int bus; // left on the data bus by the fetch, unless set when running
+    } Location_t;
+
+    //! Emit the code finding the operand, false if not translated
+    bool locate(cpu::code::AddressingKind_t mode, const uint8_t *operands, bool read, bool write,
+                Location_t &location);
+
+    //! Read the operand into ECX
+    void load(const Location_t &location);
+
+    //! Write ECX to the operand
+    void store(const Location_t &location);
+
+    //! Read the byte at the address in EAX into ECX
+    void loadComputed(int bus);
+
+    //! Write ECX to the address in EAX
+    void storeComputed();
+
+    //! Call the step of the interpreter, with the registers written back
+    void fallback(const cpu::BlockStep_t &step, uint16_t address);
+
+    //! Write the registers back to the state, or load them again
+    void spill();
+    void reload();
+
+    //! Flags N and Z of a register
+    void setZeroNegative(int reg);
+
+    //! Add ECX and flag C to register A
+    void addWithCarry();
+
+    void compare(int reg);
+
+    //! Shift or rotate ECX
+    void shift(cpu::code::InstructionKind_t type);
+
+    void branch(cpu::code::InstructionKind_t type, uint16_t next, uint16_t target);
+
+    /* Set PC to an address of the block, from the PC it is entered
+     * at, for the same block to run from each mirror of its memory
+     */
+    void storePC(uint16_t address);
+
+    //! Host memory of an address, if the page is mapped for the accesses
+    bool host(uint16_t address, bool read, bool write, const uint8_t *&rhost, uint8_t *&whost) const;
+
+private:
+
+    Assembler &_as;
+
+    const Target_t &_target;
+
+    //! Address the block is translated at
+    uint16_t _entry;
+
+    //! Ticks of the instructions translated, without the steps called
+    int _ticks;
+
+    std::vector<std::pair<int, const cpu::BlockStep_t*>> _calls;
+};
+
+void Translator::prologue()
+{
+    for (int reg : { RBX, RBP, R12, R13, R14, R15 })
+        _as.push(reg);
+    _as.aluImm64(ExtSub, RSP, FrameSize);
+    _as.store64(at(RSP, FrameCpu), RDI);
+    _as.storeImm32(at(RSP, FrameTicks), 0);
+
+    _as.set64(RegState, _target.state);
+    _as.load16(RAX, at(RegState, StatePC));
+    _as.store64(at(RSP, FrameEntry), RAX);
+    reload();
+}
+
+void Translator::epilogue(bool setPC, uint16_t address)
+{
+    spill();
+    if (setPC)
+        storePC(address);
+
+    _as.load32(RAX, at(RSP, FrameTicks));
+    _as.aluImm32(ExtAdd, RAX, _ticks);
+
+    _as.aluImm64(ExtAdd, RSP, FrameSize);
+    for (int reg : { R15, R14, R13, R12, RBP, RBX })
+        _as.pop(reg);
+    _as.ret();
+}
+
+void Translator::spill()
+{
+    _as.store8(at(RegState, StateA), RegA);
+    _as.store8(at(RegState, StateX), RegX);
+    _as.store8(at(RegState, StateY), RegY);
+    _as.store8(at(RegState, StateN), RegN);
+    _as.store8(at(RegState, StateZ), RegZ);
+}
+
+void Translator::reload()
+{
+    _as.load8(RegA, at(RegState, StateA));
+    _as.load8(RegX, at(RegState, StateX));
+    _as.load8(RegY, at(RegState, StateY));
+    _as.load8(RegN, at(RegState, StateN));
+    _as.load8(RegZ, at(RegState, StateZ));
+}
+
+bool Translator::translate(const cpu::BlockStep_t &step, uint16_t address)
+{
+    const cpu::Description_t &description = cpu::OperationDescriptions[step.opcode];
+    const cpu::code::AddressingKind_t mode = description.mode;
+    const uint8_t *operands = step.operands;
+    uint16_t next = address + 1 + cpu::OperationSet[step.opcode]->mode->operands;
+
+    bool read = false, write = false;
+    switch (description.type) {
+        case cpu::code::STA: case cpu::code::STX: case cpu::code::STY:
+            write = true;
+            break;
+
+        case cpu::code::ASL: case cpu::code::LSR: case cpu::code::ROL: case cpu::code::ROR:
+        case cpu::code::INC: case cpu::code::DEC:
+            read = write = mode != cpu::code::Accumulator;
+            break;
+
+        case cpu::code::LDA: case cpu::code::LDX: case cpu::code::LDY:
+        case cpu::code::AND: case cpu::code::EOR: case cpu::code::ORA: case cpu::code::BIT:
+        case cpu::code::ADC: case cpu::code::SBC:
+        case cpu::code::CMP: case cpu::code::CPX: case cpu::code::CPY:
+            read = true;
+            break;
+
+        case cpu::code::JMP:
+            if (mode == cpu::code::Absolute) {
+                _ticks += description.cycles + 1;
+                _as.storeImm16(at(RegState, StatePC), (uint16_t)(operands[1] << 8 | operands[0]));
+                return false;
+            }
+            fallback(step, address);
+            return false;
+
+        case cpu::code::BCC: case cpu::code::BCS: case cpu::code::BEQ: case cpu::code::BMI:
+        case cpu::code::BNE: case cpu::code::BPL: case cpu::code::BVC: case cpu::code::BVS:
+            _ticks += description.cycles + 1;
+            branch(description.type, next, next + (int8_t)operands[0]);
+            return false;
+
+        case cpu::code::JSR: case cpu::code::RTS: case cpu::code::RTI: case cpu::code::BRK:
+            fallback(step, address);
+            return false;
+
+        case cpu::code::PHA: case cpu::code::PHP: case cpu::code::PLA: case cpu::code::PLP:
+            fallback(step, address);
+            return true;
+
+        default:
+            break;
+    }
+
+    Location_t location;
+    if ((read || write) && !locate(mode, operands, read, write, location)) {
+        fallback(step, address);
+        return true;
+    }
+
+    _ticks += description.cycles + 1;
+
+    // Address of a read-modify-write, over the read of the bus
+    bool modify = read && write && location.kind == Location_t::Computed;
+    if (modify)
+        _as.store64(at(RSP, FrameAddress), RAX);
+
+    if (read)
+        load(location);
+
+    switch (description.type) {
+        /* Load & Store */
+        case cpu::code::LDA: _as.mov32(RegA, RCX); setZeroNegative(RegA); break;
+        case cpu::code::LDX: _as.mov32(RegX, RCX); setZeroNegative(RegX); break;
+        case cpu::code::LDY: _as.mov32(RegY, RCX); setZeroNegative(RegY); break;
+        case cpu::code::STA: _as.mov32(RCX, RegA); break;
+        case cpu::code::STX: _as.mov32(RCX, RegX); break;
+        case cpu::code::STY: _as.mov32(RCX, RegY); break;
+
+        /* Register Transfers */
+        case cpu::code::TAX: _as.mov32(RegX, RegA); setZeroNegative(RegX); break;
+        case cpu::code::TAY: _as.mov32(RegY, RegA); setZeroNegative(RegY); break;
+        case cpu::code::TXA: _as.mov32(RegA, RegX); setZeroNegative(RegA); break;
+        case cpu::code::TYA: _as.mov32(RegA, RegY); setZeroNegative(RegA); break;
+        case cpu::code::TSX: _as.load8(RegX, at(RegState, StateS)); setZeroNegative(RegX); break;
+        case cpu::code::TXS: _as.store8(at(RegState, StateS), RegX); break;
+
+        /* Status Instructions */
+        case cpu::code::CLC: _as.storeImm8(at(RegState, StateC), (uint8_t)0); break;
+        case cpu::code::SEC: _as.storeImm8(at(RegState, StateC), (uint8_t)1); break;
+        case cpu::code::CLV: _as.storeImm8(at(RegState, StateV), (uint8_t)0); break;
+        case cpu::code::CLD: _as.aluImm8(ExtAnd, at(RegState, StateP), ~static_cast<uint8_t>(cpu::StatusBit::D)); break;
+        case cpu::code::CLI: _as.aluImm8(ExtAnd, at(RegState, StateP), ~static_cast<uint8_t>(cpu::StatusBit::I)); break;
+        case cpu::code::SED: _as.aluImm8(ExtOr, at(RegState, StateP), static_cast<uint8_t>(cpu::StatusBit::D)); break;
+        case cpu::code::SEI: _as.aluImm8(ExtOr, at(RegState, StateP), static_cast<uint8_t>(cpu::StatusBit::I)); break;
+
+        /* Shift Instructions */
+        case cpu::code::ASL: case cpu::code::LSR: case cpu::code::ROL: case cpu::code::ROR:
+            if (mode == cpu::code::Accumulator) {
+                _as.mov32(RCX, RegA);
+                shift(description.type);
+                _as.mov32(RegA, RCX);
+            } else {
+                shift(description.type);
+            }
+            break;
+
+        /* Increments & Decrements */
+        case cpu::code::INC: _as.aluImm32(ExtAdd, RCX, 1); _as.movzx8(RCX, RCX); setZeroNegative(RCX); break;
+        case cpu::code::DEC: _as.aluImm32(ExtSub, RCX, 1); _as.movzx8(RCX, RCX); setZeroNegative(RCX); break;
+        case cpu::code::INX: _as.aluImm32(ExtAdd, RegX, 1); _as.movzx8(RegX, RegX); setZeroNegative(RegX); break;
+        case cpu::code::DEX: _as.aluImm32(ExtSub, RegX, 1); _as.movzx8(RegX, RegX); setZeroNegative(RegX); break;
+        case cpu::code::INY: _as.aluImm32(ExtAdd, RegY, 1); _as.movzx8(RegY, RegY); setZeroNegative(RegY); break;
+        case cpu::code::DEY: _as.aluImm32(ExtSub, RegY, 1); _as.movzx8(RegY, RegY); setZeroNegative(RegY); break;
+
+        /* Logical Instructions */
+        case cpu::code::AND: _as.alu32(OpAnd, RegA, RCX); setZeroNegative(RegA); break;
+        case cpu::code::EOR: _as.alu32(OpXor, RegA, RCX); setZeroNegative(RegA); break;
+        case cpu::code::ORA: _as.alu32(OpOr, RegA, RCX); setZeroNegative(RegA); break;
+        case cpu::code::BIT:
+            _as.mov32(RegN, RCX);
+            _as.lea32(RAX, at(RCX, RCX, 0));
+            _as.store8(at(RegState, StateV), RAX);
+            _as.mov32(RegZ, RCX);
+            _as.alu32(OpAnd, RegZ, RegA);
+            break;
+
+        /* Arithmetic Instructions, A - M - !C as A + ~M + C */
+        case cpu::code::ADC: addWithCarry(); break;
+        case cpu::code::SBC: _as.aluImm32(ExtXor, RCX, 0xff); addWithCarry(); break;
+        case cpu::code::CMP: compare(RegA); break;
+        case cpu::code::CPX: compare(RegX); break;
+        case cpu::code::CPY: compare(RegY); break;
+
+        case cpu::code::NOP:
+            break;
+
+        default:
+            break;
+    }
+
+    if (modify)
+        _as.load64(RAX, at(RSP, FrameAddress));
+
+    if (write)
+        store(location);
+
+    return true;
+}
+
+bool Translator::host(uint16_t address, bool read, bool write,
+                      const uint8_t *&rhost, uint8_t *&whost) const
+{
+    const Page_t &page = _target.pages[address >> PageShift];
+    if ((read && !page.rbase) || (write && !page.wbase))
+        return false;
+
+    rhost = page.rbase ? page.rbase + (address & page.mask) : nullptr;
+    whost = page.wbase ? page.wbase + (address & page.mask) : nullptr;
+    return true;
+}
+
+bool Translator::locate(cpu::code::AddressingKind_t mode, const uint8_t *operands, bool read, bool write,
+                        Location_t &location)
+{
+    uint16_t address = operands[1] << 8 | operands[0];
+
+    // What reads nothing keeps the last byte fetched, like open bus
+    location.bus = mode == cpu::code::ZeroPage || mode == cpu::code::IndexedZeroPageX ||
+                   mode == cpu::code::IndexedZeroPageY ? operands[0] : operands[1];
+
+    const uint8_t *rhost, *rlast;
+    uint8_t *whost, *wlast;
+    bool zeroPage = host(0, true, write, rhost, whost) && _target.pages[0].mask >= PageMask;
+
+    // Reads and writes of the zero page at the same host memory
+    if (zeroPage && write && rhost != whost)
+        zeroPage = false;
+
+    switch (mode) {
+        case cpu::code::Immediate:
+            location.kind = Location_t::Immediate;
+            location.value = operands[0];
+            return true;
+
+        case cpu::code::ZeroPage:
+        case cpu::code::Absolute:
+            if (mode == cpu::code::ZeroPage)
+                address = operands[0];
+
+            location.address = address;
+            if (host(address, read, write, location.rhost, location.whost))
+                location.kind = Location_t::Host;
+            else
+                location.kind = Location_t::Bus;
+            return true;
+
+        case cpu::code::IndexedZeroPageX:
+        case cpu::code::IndexedZeroPageY: {
+            int index = mode == cpu::code::IndexedZeroPageX ? RegX : RegY;
+            _as.lea32(zeroPage ? RSI : RAX, at(index, operands[0]));
+            if (zeroPage) {
+                _as.movzx8(RSI, RSI);
+                _as.set64(R8, rhost);
+                location.kind = Location_t::Indexed;
+                location.index = RSI;
+            } else {
+                _as.movzx8(RAX, RAX);
+                location.kind = Location_t::Computed;
+            }
+            return true;
+        }
+
+        case cpu::code::IndexedAbsoluteX:
+        case cpu::code::IndexedAbsoluteY: {
+            int index = mode == cpu::code::IndexedAbsoluteX ? RegX : RegY;
+
+            // Reads of host memory running on to the next page
+            if (!write && host(address, true, false, rhost, whost) &&
+                host(address + PageMask, true, false, rlast, wlast) && rlast == rhost + PageMask) {
+                _as.set64(R8, rhost);
+                location.kind = Location_t::Indexed;
+                location.index = index;
+                return true;
+            }
+
+            _as.lea32(RAX, at(index, address));
+            _as.movzx16(RAX, RAX);
+            location.kind = Location_t::Computed;
+            return true;
+        }
+
+        case cpu::code::IndexedIndirect:
+            if (!zeroPage)
+                return false;
+
+            _as.set64(R8, rhost);
+            _as.lea32(RSI, at(RegX, operands[0]));
+            _as.movzx8(RSI, RSI);
+            _as.load8(RCX, at(R8, RSI, 0));
+            _as.lea32(RSI, at(RSI, 1));
+            _as.movzx8(RSI, RSI);
+            _as.load8(RAX, at(R8, RSI, 0));
+            _as.store8(at(RegState, StateDBB), RAX);
+            _as.shift32(ExtShl, RAX, 8);
+            _as.alu32(OpOr, RAX, RCX);
+            location.kind = Location_t::Computed;
+            location.bus = -1;
+            return true;
+
+        case cpu::code::IndirectIndexed:
+            if (!zeroPage)
+                return false;
+
+            _as.set64(R8, rhost);
+            _as.load8(RCX, at(R8, operands[0]));
+            _as.load8(RAX, at(R8, (uint8_t)(operands[0] + 1)));
+            _as.store8(at(RegState, StateDBB), RAX);
+            _as.shift32(ExtShl, RAX, 8);
+            _as.alu32(OpOr, RAX, RCX);
+            _as.alu32(OpAdd, RAX, RegY);
+            _as.movzx16(RAX, RAX);
+            location.kind = Location_t::Computed;
+            location.bus = -1;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+void Translator::load(const Location_t &location)
+{
+    switch (location.kind) {
+        case Location_t::Immediate:
+            _as.set32(RCX, location.value);
+            break;
+
+        case Location_t::Host:
+            _as.set64(RAX, location.rhost);
+            _as.load8(RCX, at(RAX));
+            break;
+
+        case Location_t::Bus:
+            _as.storeImm8(at(RegState, StateDBB), (uint8_t)location.bus);
+            _as.load64(RDI, at(RSP, FrameCpu));
+            _as.set32(RSI, location.address);
+            _as.call((const void*)_target.read);
+            _as.movzx8(RCX, RAX);
+            break;
+
+        case Location_t::Indexed:
+            _as.load8(RCX, at(R8, location.index, 0));
+            break;
+
+        case Location_t::Computed:
+            loadComputed(location.bus);
+            break;
+    }
+}
+
+void Translator::store(const Location_t &location)
+{
+    switch (location.kind) {
+        case Location_t::Host: {
+            // Unless the page holds blocks translated from RAM, when
+            // running. The zero page never does
+            int slow = -1, done = -1;
+            if (location.address > PageMask) {
+                _as.set64(RAX, _target.codePages + (location.address >> PageShift));
+                _as.aluImm8(ExtCmp, at(RAX), 0);
+                slow = _as.jump(CondNotEqual);
+            }
+
+            _as.set64(RAX, location.whost);
+            _as.store8(at(RAX), RCX);
+
+            if (slow < 0)
+                break;
+
+            done = _as.jump();
+            _as.bind(slow);
+            _as.load64(RDI, at(RSP, FrameCpu));
+            _as.set32(RSI, location.address);
+            _as.mov32(RDX, RCX);
+            _as.call((const void*)_target.write);
+            _as.bind(done);
+            break;
+        }
+
+        case Location_t::Bus:
+            _as.load64(RDI, at(RSP, FrameCpu));
+            _as.set32(RSI, location.address);
+            _as.mov32(RDX, RCX);
+            _as.call((const void*)_target.write);
+            break;
+
+        case Location_t::Indexed:
+            _as.store8(at(R8, location.index, 0), RCX);
+            break;
+
+        case Location_t::Computed:
+            storeComputed();
+            break;
+
+        default:
+            break;
+    }
+}
+
+void Translator::loadComputed(int bus)
+{
+    // The entry of the page
+    _as.mov32(RCX, RAX);
+    _as.shift32(ExtShr, RCX, PageShift);
+    _as.imul32(RCX, RCX, sizeof(Page_t));
+    _as.set64(RDX, _target.pages);
+    _as.add64(RDX, RCX);
+
+    _as.load64(RSI, at(RDX, PageRead));
+    _as.test64(RSI, RSI);
+    int slow = _as.jump(CondEqual);
+
+    _as.load16(RCX, at(RDX, PageMirror));
+    _as.alu32(OpAnd, RCX, RAX);
+    _as.load8(RCX, at(RSI, RCX, 0));
+    int done = _as.jump();
+
+    _as.bind(slow);
+    if (bus >= 0)
+        _as.storeImm8(at(RegState, StateDBB), (uint8_t)bus);
+    _as.load64(RDI, at(RSP, FrameCpu));
+    _as.mov32(RSI, RAX);
+    _as.call((const void*)_target.read);
+    _as.movzx8(RCX, RAX);
+    _as.bind(done);
+}
+
+void Translator::storeComputed()
+{
+    // Through the CPU, if the page holds blocks translated from RAM
+    _as.mov32(RDX, RAX);
+    _as.shift32(ExtShr, RDX, PageShift);
+    _as.set64(RSI, _target.codePages);
+    _as.aluImm8(ExtCmp, at(RSI, RDX, 0), 0);
+    int marked = _as.jump(CondNotEqual);
+
+    _as.imul32(RDX, RDX, sizeof(Page_t));
+    _as.set64(RSI, _target.pages);
+    _as.add64(RSI, RDX);
+
+    _as.load64(RDI, at(RSI, PageWrite));
+    _as.test64(RDI, RDI);
+    int slow = _as.jump(CondEqual);
+
+    _as.load16(RDX, at(RSI, PageMirror));
+    _as.alu32(OpAnd, RDX, RAX);
+    _as.store8(at(RDI, RDX, 0), RCX);
+    int done = _as.jump();
+
+    _as.bind(marked);
+    _as.bind(slow);
+    _as.load64(RDI, at(RSP, FrameCpu));
+    _as.mov32(RSI, RAX);
+    _as.mov32(RDX, RCX);
+    _as.call((const void*)_target.write);
+    _as.bind(done);
+}
+
+void Translator::fallback(const cpu::BlockStep_t &step, uint16_t address)
+{
+    spill();
+    storePC(address);
+
+    _as.load64(RDI, at(RSP, FrameCpu));
+    _calls.push_back({ _as.leaRip(RSI), &step });
+    _as.call((const void*)step.run);
+    _as.add32(at(RSP, FrameTicks), RAX);
+
+    reload();
+}
+
+void Translator::setZeroNegative(int reg)
+{
+    _as.mov32(RegN, reg);
+    _as.mov32(RegZ, reg);
+}
+
+void Translator::addWithCarry()
+{
+    _as.load8(RAX, at(RegState, StateC));
+    _as.alu32(OpAdd, RAX, RegA);
+    _as.alu32(OpAdd, RAX, RCX);
+
+    // Overflow if the sign of the result differs from both operands
+    _as.mov32(RDX, RegA);
+    _as.alu32(OpXor, RDX, RAX);
+    _as.mov32(RSI, RCX);
+    _as.alu32(OpXor, RSI, RAX);
+    _as.alu32(OpAnd, RDX, RSI);
+    _as.store8(at(RegState, StateV), RDX);
+
+    _as.mov32(RDX, RAX);
+    _as.shift32(ExtShr, RDX, 8);
+    _as.store8(at(RegState, StateC), RDX);
+
+    _as.movzx8(RegA, RAX);
+    setZeroNegative(RegA);
+}
+
+void Translator::compare(int reg)
+{
+    _as.alu32(OpCmp, reg, RCX);
+    _as.set8(CondAboveEqual, at(RegState, StateC));
+
+    _as.mov32(RAX, reg);
+    _as.alu32(OpSub, RAX, RCX);
+    _as.movzx8(RegN, RAX);
+    _as.mov32(RegZ, RegN);
+}
+
+void Translator::shift(cpu::code::InstructionKind_t type)
+{
+    bool rotate = type == cpu::code::ROL || type == cpu::code::ROR;
+    if (rotate)
+        _as.load8(RDX, at(RegState, StateC));
+
+    _as.mov32(RAX, RCX);
+    if (type == cpu::code::ASL || type == cpu::code::ROL) {
+        _as.shift32(ExtShr, RAX, 7);
+        _as.alu32(OpAdd, RCX, RCX);
+        if (rotate)
+            _as.alu32(OpOr, RCX, RDX);
+        _as.movzx8(RCX, RCX);
+    } else {
+        _as.aluImm32(ExtAnd, RAX, 1);
+        _as.shift32(ExtShr, RCX, 1);
+        if (rotate) {
+            _as.shift32(ExtShl, RDX, 7);
+            _as.alu32(OpOr, RCX, RDX);
+        }
+    }
+    _as.store8(at(RegState, StateC), RAX);
+
+    setZeroNegative(RCX);
+}
+
+void Translator::branch(cpu::code::InstructionKind_t type, uint16_t next, uint16_t target)
+{
+    storePC(next);
+
+    // Over the jump to the target, unless taken
+    int skip = -1;
+    switch (type) {
+        case cpu::code::BEQ: _as.test32(RegZ, RegZ); skip = _as.jump(CondNotEqual); break;
+        case cpu::code::BNE: _as.test32(RegZ, RegZ); skip = _as.jump(CondEqual); break;
+        case cpu::code::BMI: _as.test8(RegN, 0x80); skip = _as.jump(CondEqual); break;
+        case cpu::code::BPL: _as.test8(RegN, 0x80); skip = _as.jump(CondNotEqual); break;
+        case cpu::code::BCS: _as.aluImm8(ExtCmp, at(RegState, StateC), 0); skip = _as.jump(CondEqual); break;
+        case cpu::code::BCC: _as.aluImm8(ExtCmp, at(RegState, StateC), 0); skip = _as.jump(CondNotEqual); break;
+        case cpu::code::BVS: _as.test8(at(RegState, StateV), 0x80); skip = _as.jump(CondEqual); break;
+        case cpu::code::BVC: _as.test8(at(RegState, StateV), 0x80); skip = _as.jump(CondNotEqual); break;
+        default: break;
+    }
+
+    storePC(target);
+    _as.bind(skip);
+}
+
+void Translator::storePC(uint16_t address)
+{
+    _as.load32(RAX, at(RSP, FrameEntry));
+    _as.aluImm32(ExtAdd, RAX, (uint16_t)(address - _entry));
+    _as.store16(at(RegState, StatePC), RAX);
+}
+
+Compiler::Compiler(int capacity)
+    : _code(nullptr)
+    , _buffer(nullptr)
+    , _capacity(0)
+    , _size(0)
+    , _perfMap(nullptr)
+{
+    // The same memory mapped twice, never writable and executable at once
+    int fd = memfd_create("tones-jit", MFD_CLOEXEC);
+    if (fd < 0 || ftruncate(fd, capacity)) {
+        LOG_ERROR() << "Failed to create " << capacity << " bytes for code";
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+
+    void *buffer = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    void *code = mmap(nullptr, capacity, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (MAP_FAILED == buffer || MAP_FAILED == code) {
+        LOG_ERROR() << "Failed to map " << capacity << " bytes for code";
+        if (MAP_FAILED != buffer)
+            munmap(buffer, capacity);
+        if (MAP_FAILED != code)
+            munmap(code, capacity);
+        return;
+    }
+
+    _buffer = (uint8_t*)buffer;
+    _code = (uint8_t*)code;
+    _capacity = capacity;
+
+    std::string path = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+    _perfMap = fopen(path.c_str(), "a");
+    if (!_perfMap)
+        LOG_WARN() << "Failed to open " << path;
+}
+
+Compiler::~Compiler()
+{
+    if (_code) {
+        munmap(_code, _capacity);
+        munmap(_buffer, _capacity);
+    }
+
+    if (_perfMap)
+        fclose(_perfMap);
+}
+
+Function Compiler::compile(MicroProcessor &cpu, const cpu::Block &block, uint16_t address)
+{
+    int count = block.steps.size();
+    int begin = (_size + CodeAlignment - 1) & ~(CodeAlignment - 1);
+    int end = begin + BlockCodeSize + count * (InstructionCodeSize + OperandsSize);
+
+    if (!_code || end > _capacity)
+        return nullptr;
+
+    const Target_t target = {
+        &cpu._state,
+        &cpu._bus.page(0),
+        cpu._codePages.data(),
+        &Compiler::read,
+        &Compiler::write
+    };
+
+    Assembler as(_buffer + begin);
+    Translator translator(as, target, address);
+
+    translator.prologue();
+
+    bool open = true;
+    uint16_t pc = address;
+    for (const cpu::BlockStep_t &step : block.steps) {
+        open = translator.translate(step, pc);
+        pc += 1 + cpu::OperationSet[step.opcode]->mode->operands;
+    }
+
+    // Unless the last instruction jumps, the next one
+    translator.epilogue(open, pc);
+    int code = as.size();
+
+    // Operands of the steps called, right after the code
+    for (auto &call : translator.calls()) {
+        as.patch(call.first, as.size());
+        for (uint8_t operand : call.second->operands)
+            as.bytes({ operand });
+    }
+
+    _size = begin + as.size();
+
+    if (_perfMap) {
+        fprintf(_perfMap, "%" PRIxPTR " %x tones_6502_%04X\n",
+                (uintptr_t)(_code + begin), code, address);
+        fflush(_perfMap);
+    }
+
+    return (Function)(_code + begin);
+}
+
+uint8_t Compiler::read(MicroProcessor *cpu, uint16_t address)
+{
+    cpu->_state.AB = address;
+    cpu->_bus.read(address, cpu->_state.DBB);
+    return cpu->_state.DBB;
+}
+
+void Compiler::write(MicroProcessor *cpu, uint16_t address, uint8_t data)
+{
+    cpu->_state.AB = address;
+    cpu->_state.DBB = data;
+    cpu->_bus.write(address, data);
+
+    if (cpu->_codePages[address >> PageShift])
+        cpu->invalidate();
+}
+
+#else
+
+Compiler::Compiler(int)
+    : _code(nullptr)
+    , _buffer(nullptr)
+    , _capacity(0)
+    , _size(0)
+    , _perfMap(nullptr)
+{
+}
+
+Compiler::~Compiler() {}
+
+Function Compiler::compile(MicroProcessor &, const cpu::Block &, uint16_t)
+{
+    return nullptr;
+}
+
+uint8_t Compiler::read(MicroProcessor *, uint16_t)
+{
+    return 0;
+}
+
+void Compiler::write(MicroProcessor *, uint16_t, uint8_t) {}
+
+#endif // TONES_JIT
+
+void Compiler::reset()
+{
+    _size = 0;
+}
+
+int Compiler::size() const
+{
+    return _size;
+}
+
+} // namespace jit
+} // namespace tones
@@ -0,0 +1,209 @@
+#include "Lockstep.h"
+
+#include <iomanip>
+
+#include "Instruction.h"
+
+namespace tones {
+namespace cpu {
+
+/* Machine */
+
+Lockstep::Machine::Machine(Dispatch dispatch)
+    : cpu(mbus)
+    , origin(0)
+{
+    pram.attach(mbus);
+    sram.attach(mbus);
+
+    cpu.setDispatch(dispatch);
+
+    mbus.setWatcher([this] (uint16_t address, uint8_t data, Access) {
+        writes.push_back({ address, data });
+    });
+}
+
+void Lockstep::Machine::dump(MicroProcessor::Registers_t &registers, uint64_t &tick) const
+{
+    State_t state;
+    cpu.save(state);
+    cpu.dump(registers);
+
+    tick = state.cycles + state.skip - origin;
+}
+
+/* Lockstep */
+
+Lockstep::Lockstep(Dispatch reference, Dispatch candidate)
+    : _reference(reference)
+    , _candidate(candidate)
+    , _diverged(false)
+    , _divergence()
+{
+}
+
+bool Lockstep::insert(const std::string &path)
+{
+    for (Machine *machine : { &_reference, &_candidate }) {
+        CartridgePtr card = CartridgeFactory::createCartridge(path);
+        if (!card)
+            return false;
+
+        if (machine->card)
+            machine->card->detach();
+
+        machine->card = card;
+        machine->card->attach(machine->mbus, machine->vbus);
+
+        // Writes to anything but read-only memory, which keeps
+        // the pages of code cached by the cores
+        machine->mbus.unwatch();
+        for (int base = 0; base < AddressSpace; base += PageSize) {
+            const Page_t &page = machine->mbus.page(base);
+            if (page.rbase && !page.wbase)
+                continue;
+
+            for (int offset = 0; offset < PageSize; ++offset)
+                machine->mbus.watch(base + offset, Access::Write);
+        }
+    }
+
+    reset();
+    return true;
+}
+
+void Lockstep::reset()
+{
+    uint8_t pram[RandomAccessMemory::RamSize];
+    uint8_t sram[SaveRandomAccessMemory::SramSize];
+
+    _reference.mbus.dump(RandomAccessMemory::RamLowerBound, pram, sizeof(pram));
+    _reference.mbus.dump(SaveRandomAccessMemory::SramLowerBound, sram, sizeof(sram));
+
+    for (int i = 0; i < (int)sizeof(pram); ++i)
+        _candidate.mbus.write(RandomAccessMemory::RamLowerBound + i, pram[i]);
+
+    for (int i = 0; i < (int)sizeof(sram); ++i)
+        _candidate.mbus.write(SaveRandomAccessMemory::SramLowerBound + i, sram[i]);
+
+    for (Machine *machine : { &_reference, &_candidate }) {
+        machine->cpu.reset();
+        machine->writes.clear();
+        machine->origin = machine->cpu.cycles();
+    }
+
+    _diverged = false;
+}
+
+void Lockstep::jump(uint16_t address)
+{
+    _reference.cpu.jump(address);
+    _candidate.cpu.jump(address);
+}
+
+bool Lockstep::run(uint64_t instructions)
+{
+    uint64_t end = _reference.cpu.instructions() + instructions;
+
+    while (!_diverged && _reference.cpu.instructions() < end)
+        _diverged = !step();
+
+    return !_diverged;
+}
+
+uint64_t Lockstep::instructions() const
+{
+    return _reference.cpu.instructions();
+}
+
+const Lockstep::Divergence_t &Lockstep::divergence() const
+{
+    return _divergence;
+}
+
+MicroProcessor &Lockstep::reference()
+{
+    return _reference.cpu;
+}
+
+MicroProcessor &Lockstep::candidate()
+{
+    return _candidate.cpu;
+}
+
+bool Lockstep::step()
+{
+    Divergence_t &d = _divergence;
+
+    _reference.cpu.dump(d.expected);
+    d.instruction = _reference.cpu.instructions();
+    d.address = d.expected.PC;
+    _reference.mbus.peek(d.address, d.opcode);
+
+    _reference.writes.clear();
+    _candidate.writes.clear();
+
+    // As many instructions as the step of the candidate, or
+    // one interrupt served by both
+    _candidate.cpu.step();
+    do {
+        _reference.cpu.step();
+    } while (_reference.cpu.instructions() < _candidate.cpu.instructions());
+
+    _reference.dump(d.expected, d.expectedTick);
+    _candidate.dump(d.actual, d.actualTick);
+    d.expectedWrites = _reference.writes;
+    d.actualWrites = _candidate.writes;
+
+    return _reference.cpu.instructions() == _candidate.cpu.instructions()
+        && d.expected.A == d.actual.A
+        && d.expected.X == d.actual.X
+        && d.expected.Y == d.actual.Y
+        && d.expected.S == d.actual.S
+        && d.expected.P == d.actual.P
+        && d.expected.PC == d.actual.PC
+        && d.expectedTick == d.actualTick
+        && d.expectedWrites == d.actualWrites;
+}
+
+static void printWrites(std::ostream &out, const std::vector<Lockstep::Write_t> &writes)
+{
+    for (const Lockstep::Write_t &write : writes)
+        out << " $" << std::setw(4) << write.address << "=$" << std::setw(2) << (int)write.data;
+}
+
+void Lockstep::report(std::ostream &out) const
+{
+    if (!_diverged) {
+        out << "No divergence in " << std::dec << instructions() << " instructions" << std::endl;
+        return;
+    }
+
+    const Divergence_t &d = _divergence;
+    const Operation_t *operation = OperationSet[d.opcode];
+
+    out << std::hex << std::uppercase << std::setfill('0')
+        << "Diverged at instruction " << std::dec << d.instruction << std::hex
+        << ", $" << std::setw(4) << d.address << " " << operation->type->name
+        << " " << operation->mode->name << " ($" << std::setw(2) << (int)d.opcode << ")"
+        << std::endl;
+
+    out << "          PC   A  X  Y  S  P  next tick" << std::endl;
+    for (int i = 0; i < 2; ++i) {
+        const MicroProcessor::Registers_t &r = i ? d.actual : d.expected;
+        out << (i ? "actual    " : "expected  ")
+            << std::setw(4) << r.PC << " " << std::setw(2) << (int)r.A
+            << " " << std::setw(2) << (int)r.X << " " << std::setw(2) << (int)r.Y
+            << " " << std::setw(2) << (int)r.S << " " << std::setw(2) << (int)r.P
+            << " " << std::dec << (i ? d.actualTick : d.expectedTick) << std::hex << std::endl;
+    }
+
+    out << "expected writes:";
+    printWrites(out, d.expectedWrites);
+    out << std::endl << "actual writes:  ";
+    printWrites(out, d.actualWrites);
+    out << std::endl << std::dec << std::nouppercase << std::setfill(' ');
+}
+
+} // namespace cpu
+} // namespace tones
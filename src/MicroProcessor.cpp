@@ -1,170 +1,169 @@
 
 #include "MicroProcessor.h"
+
+#include <algorithm>
+#include <type_traits>
+
 #include "Register.h"
 
 namespace tones {
 namespace cpu {
 
-/* ArithmeticAndLogicUnit */
+static_assert(sizeof(State_t) == 64, "The state of the CPU fills one cache line");
+static_assert(std::is_trivially_copyable<State_t>::value, "The state of the CPU is copied as bytes");
 
-ArithmeticAndLogicUnit::ArithmeticAndLogicUnit(tones::MicroProcessor &cpu)
-    : _reg_A(cpu._reg_A)
-    , _reg_DBB(cpu._reg_DBB)
-    , _reg_P(cpu._reg_P)
-{
-
-}
+/* ArithmeticAndLogicUnit */
 
 /* One operand operations */
 
-void ArithmeticAndLogicUnit::INC()
+void ArithmeticAndLogicUnit::INC(State_t &state)
 {
-    ++_reg_A;
-    setZeroNegative(_reg_A);
+    ++state.A;
+    setZeroNegative(state, state.A);
 }
 
-void ArithmeticAndLogicUnit::DEC()
+void ArithmeticAndLogicUnit::DEC(State_t &state)
 {
-    --_reg_A;
-    setZeroNegative(_reg_A);
+    --state.A;
+    setZeroNegative(state, state.A);
 }
 
-void ArithmeticAndLogicUnit::ASL()
+void ArithmeticAndLogicUnit::ASL(State_t &state)
 {
-    setCarry(_reg_A & 0x80);
-    _reg_A <<= 1;
-    setZeroNegative(_reg_A);
+    setCarry(state, state.A & 0x80);
+    state.A <<= 1;
+    setZeroNegative(state, state.A);
 }
 
-void ArithmeticAndLogicUnit::LSR()
+void ArithmeticAndLogicUnit::LSR(State_t &state)
 {
-    setCarry(_reg_A & 0x01);
-    _reg_A >>= 1;
-    setZeroNegative(_reg_A);
+    setCarry(state, state.A & 0x01);
+    state.A >>= 1;
+    setZeroNegative(state, state.A);
 }
 
-void ArithmeticAndLogicUnit::ROL()
+void ArithmeticAndLogicUnit::ROL(State_t &state)
 {
-    _reg_A <<= 1;
-    _reg_A |= getCarry() ? 0x01 : 0x00;
-    setCarry(_reg_DBB & 0x80);
-    setZeroNegative(_reg_A);
+    state.A <<= 1;
+    state.A |= getCarry(state) ? 0x01 : 0x00;
+    setCarry(state, state.DBB & 0x80);
+    setZeroNegative(state, state.A);
 }
 
-void ArithmeticAndLogicUnit::ROR()
+void ArithmeticAndLogicUnit::ROR(State_t &state)
 {
-    _reg_A >>= 1;
-    _reg_A |= getCarry() ? 0x80 : 0x00;
-    setCarry(_reg_DBB & 0x01);
-    setZeroNegative(_reg_A);
+    state.A >>= 1;
+    state.A |= getCarry(state) ? 0x80 : 0x00;
+    setCarry(state, state.DBB & 0x01);
+    setZeroNegative(state, state.A);
 }
 
 /* Two operands operations */
 
-void ArithmeticAndLogicUnit::ORA()
+void ArithmeticAndLogicUnit::ORA(State_t &state)
 {
-    _reg_A |= _reg_DBB;
-    setZeroNegative(_reg_A);
+    state.A |= state.DBB;
+    setZeroNegative(state, state.A);
 }
 
-void ArithmeticAndLogicUnit::AND()
+void ArithmeticAndLogicUnit::AND(State_t &state)
 {
-    _reg_A &= _reg_DBB;
-    setZeroNegative(_reg_A);
+    state.A &= state.DBB;
+    setZeroNegative(state, state.A);
 }
 
-void ArithmeticAndLogicUnit::EOR()
+void ArithmeticAndLogicUnit::EOR(State_t &state)
 {
-    _reg_A ^= _reg_DBB;
-    setZeroNegative(_reg_A);
+    state.A ^= state.DBB;
+    setZeroNegative(state, state.A);
 }
 
-void ArithmeticAndLogicUnit::ADC()
+void ArithmeticAndLogicUnit::ADC(State_t &state)
 {
     // TODO: Without tmp?
-    uint16_t tmp = _reg_A + _reg_DBB + (getCarry() ? 1 : 0);
+    uint16_t tmp = state.A + state.DBB + (getCarry(state) ? 1 : 0);
     // Signed overflow is true when the result sign differs from both operands
-    setOverflow((_reg_A ^ tmp) & (_reg_DBB ^ tmp) & 0x80);
-    setCarry(tmp & 0x100); // unsigned overflow
-    _reg_A = tmp & 0xff;
-    setZeroNegative(_reg_A);
+    setOverflow(state, (state.A ^ tmp) & (state.DBB ^ tmp));
+    setCarry(state, tmp & 0x100); // unsigned overflow
+    state.A = tmp & 0xff;
+    setZeroNegative(state, state.A);
     // No desimal mode in NES
 }
 
-void ArithmeticAndLogicUnit::SBC()
+void ArithmeticAndLogicUnit::SBC(State_t &state)
 {
     // TODO: What does it mean ?
     // TODO: Without tmp?
-    uint16_t tmp = _reg_A - _reg_DBB - (getCarry() ? 0 : 1);
-    setCarry(!(tmp & 0x100));
-    setOverflow((_reg_A ^ tmp) & (~_reg_DBB ^ tmp) & 0x80);
-    _reg_A = tmp & 0xff;
-    setZeroNegative(_reg_A);
+    uint16_t tmp = state.A - state.DBB - (getCarry(state) ? 0 : 1);
+    setCarry(state, !(tmp & 0x100));
+    setOverflow(state, (state.A ^ tmp) & (~state.DBB ^ tmp));
+    state.A = tmp & 0xff;
+    setZeroNegative(state, state.A);
     // No desimal mode in NES
 }
 
-void ArithmeticAndLogicUnit::CMP()
+void ArithmeticAndLogicUnit::CMP(State_t &state)
 {
     // TODO: What does it mean ?
-    std::uint16_t tmp = _reg_A - _reg_DBB;
-    setCarry(!(tmp & 0x100));
-    setZeroNegative(tmp);
-    // _reg_A -= _reg_DBB;
-    // setCarry(_reg_A & 0x80); // TODO: ???
-    // setZeroNegative(_reg_A);
+    std::uint16_t tmp = state.A - state.DBB;
+    setCarry(state, !(tmp & 0x100));
+    setZeroNegative(state, tmp);
+    // state.A -= state.DBB;
+    // setCarry(state, state.A & 0x80); // TODO: ???
+    // setZeroNegative(state, state.A);
 }
 
-inline void ArithmeticAndLogicUnit::setZero(uint8_t reg)
+inline void ArithmeticAndLogicUnit::setZero(State_t &state, uint8_t reg)
 {
-    SET_BIT(_reg_P, StatusBit::Z, !reg);
+    state.flags.Z = reg;
 }
 
-inline void ArithmeticAndLogicUnit::setNegative(uint8_t reg)
+inline void ArithmeticAndLogicUnit::setNegative(State_t &state, uint8_t reg)
 {
-    SET_BIT(_reg_P, StatusBit::N, reg & 0x80);
+    state.flags.N = reg;
 }
 
-inline void ArithmeticAndLogicUnit::setZeroNegative(uint8_t reg)
+inline void ArithmeticAndLogicUnit::setZeroNegative(State_t &state, uint8_t reg)
 {
-    setZero(reg);
-    setNegative(reg);
+    setZero(state, reg);
+    setNegative(state, reg);
 }
 
-inline void ArithmeticAndLogicUnit::setCarry(bool val)
+inline void ArithmeticAndLogicUnit::setCarry(State_t &state, bool val)
 {
-    SET_BIT(_reg_P, StatusBit::C, val);
+    state.flags.C = val;
 }
 
-inline void ArithmeticAndLogicUnit::setOverflow(bool val)
+inline void ArithmeticAndLogicUnit::setOverflow(State_t &state, uint8_t reg)
 {
-    SET_BIT(_reg_P, StatusBit::V, val);
+    state.flags.V = reg;
 }
 
-inline bool ArithmeticAndLogicUnit::getZero()
+inline bool ArithmeticAndLogicUnit::getZero(State_t &state)
 {
-    return GET_BIT(_reg_P, StatusBit::Z);
+    return !state.flags.Z;
 }
 
-inline bool ArithmeticAndLogicUnit::getNegative()
+inline bool ArithmeticAndLogicUnit::getNegative(State_t &state)
 {
-    return GET_BIT(_reg_P, StatusBit::N);
+    return state.flags.N & 0x80;
 }
 
-inline bool ArithmeticAndLogicUnit::getCarry()
+inline bool ArithmeticAndLogicUnit::getCarry(State_t &state)
 {
-    return GET_BIT(_reg_P, StatusBit::C);
+    return state.flags.C;
 }
 
-inline bool ArithmeticAndLogicUnit::getOverflow()
+inline bool ArithmeticAndLogicUnit::getOverflow(State_t &state)
 {
-    return GET_BIT(_reg_P, StatusBit::V);
+    return state.flags.V & 0x80;
 }
 
 /* InstructionDecoder */
 
 InstructionDecoder::InstructionDecoder(tones::MicroProcessor &cpu)
     : _cpu(cpu)
-    , _alu(cpu._alu)
+    , _state(cpu._state)
     , _operation(&UnknownOperation)
 {
 
@@ -172,8 +171,8 @@ InstructionDecoder::InstructionDecoder(tones::MicroProcessor &cpu)
 
 inline void InstructionDecoder::decode()
 {
-    _operation = OperationSet[_cpu._reg_IR];
-    _cpu._skip = _operation->cycles; // TODO: Dynamic cycles
+    _operation = OperationSet[_state.IR];
+    _state.skip = _operation->cycles; // TODO: Dynamic cycles
 }
 
 inline void InstructionDecoder::execute()
@@ -181,18 +180,18 @@ inline void InstructionDecoder::execute()
     (this->*(_operation->type->executor))();
 }
 
-inline void InstructionDecoder::accumulate(void (ArithmeticAndLogicUnit::*executor)())
+inline void InstructionDecoder::accumulate(void (*executor)(State_t &state))
 {
     if (cpu::code::Accumulator == _operation->mode->kind) {
-        _cpu._reg_DBB = _cpu._reg_A;
-        (_alu.*executor)();
+        _state.DBB = _state.A;
+        executor(_state);
     } else {
         _cpu.read();
-        _cpu._reg_DL = _cpu._reg_A;
-        _cpu._reg_A = _cpu._reg_DBB;
-        (_alu.*executor)();
-        _cpu._reg_DBB = _cpu._reg_A;
-        _cpu._reg_A = _cpu._reg_DL;
+        _state.DL = _state.A;
+        _state.A = _state.DBB;
+        executor(_state);
+        _state.DBB = _state.A;
+        _state.A = _state.DL;
         _cpu.write();
     }
 }
@@ -202,13 +201,13 @@ inline void InstructionDecoder::accumulate(void (ArithmeticAndLogicUnit::*execut
 void InstructionDecoder::ADC()
 {
     _cpu.read();
-    _alu.ADC();
+    ALU::ADC(_state);
 }
 
 void InstructionDecoder::AND()
 {
     _cpu.read();
-    _alu.AND();
+    ALU::AND(_state);
 }
 
 void InstructionDecoder::ASL()
@@ -219,7 +218,7 @@ void InstructionDecoder::ASL()
 void InstructionDecoder::BCC()
 {
     _cpu.read();
-    if (!_alu.getCarry()) {
+    if (!ALU::getCarry(_state)) {
         // TODO: Dynamic clock
         _cpu.branch();
     }
@@ -228,7 +227,7 @@ void InstructionDecoder::BCC()
 void InstructionDecoder::BCS()
 {
     _cpu.read();
-    if (_alu.getCarry()) {
+    if (ALU::getCarry(_state)) {
         // TODO: Dynamic clock
         _cpu.branch();
     }
@@ -237,7 +236,7 @@ void InstructionDecoder::BCS()
 void InstructionDecoder::BEQ()
 {
     _cpu.read();
-    if (_alu.getZero()) {
+    if (ALU::getZero(_state)) {
         // TODO: Dynamic clock
         _cpu.branch();
     }
@@ -246,15 +245,15 @@ void InstructionDecoder::BEQ()
 void InstructionDecoder::BIT()
 {
     _cpu.read();
-    _alu.setNegative(_cpu._reg_DBB);
-    _alu.setOverflow(_cpu._reg_DBB & 0x40);
-    _alu.setZero(_cpu._reg_DBB & _cpu._reg_A);
+    ALU::setNegative(_state, _state.DBB);
+    ALU::setOverflow(_state, _state.DBB << 1);
+    ALU::setZero(_state, _state.DBB & _state.A);
 }
 
 void InstructionDecoder::BMI()
 {
     _cpu.read();
-    if (_alu.getNegative()) {
+    if (ALU::getNegative(_state)) {
         // TODO: Dynamic clock
         _cpu.branch();
     }
@@ -263,7 +262,7 @@ void InstructionDecoder::BMI()
 void InstructionDecoder::BNE()
 {
     _cpu.read();
-    if (!_alu.getZero()) {
+    if (!ALU::getZero(_state)) {
         // TODO: Dynamic clock
         _cpu.branch();
     }
@@ -272,7 +271,7 @@ void InstructionDecoder::BNE()
 void InstructionDecoder::BPL()
 {
     _cpu.read();
-    if (!_alu.getNegative()) {
+    if (!ALU::getNegative(_state)) {
         // TODO: Dynamic clock
         _cpu.branch();
     }
@@ -280,16 +279,16 @@ void InstructionDecoder::BPL()
 
 void InstructionDecoder::BRK()
 {
-    ++_cpu._reg_PC; // 6502 quirk
-    SEL_BIT(_cpu._reg_P, cpu::StatusBit::B);
+    ++_state.PC; // 6502 quirk
+    SEL_BIT(_state.P, cpu::StatusBit::B);
     _cpu.interrupt(cpu::VectorIRQ);
-    CLR_BIT(_cpu._reg_P, cpu::StatusBit::B);
+    CLR_BIT(_state.P, cpu::StatusBit::B);
 }
 
 void InstructionDecoder::BVC()
 {
     _cpu.read();
-    if (!_alu.getOverflow()) {
+    if (!ALU::getOverflow(_state)) {
         // TODO: Dynamic clock
         _cpu.branch();
     }
@@ -298,7 +297,7 @@ void InstructionDecoder::BVC()
 void InstructionDecoder::BVS()
 {
     _cpu.read();
-    if (_alu.getOverflow()) {
+    if (ALU::getOverflow(_state)) {
         // TODO: Dynamic clock
         _cpu.branch();
     }
@@ -306,152 +305,152 @@ void InstructionDecoder::BVS()
 
 void InstructionDecoder::CLC()
 {
-    CLR_BIT(_cpu._reg_P, StatusBit::C);
+    ALU::setCarry(_state, false);
 }
 
 void InstructionDecoder::CLD()
 {
-    CLR_BIT(_cpu._reg_P, StatusBit::D);
+    CLR_BIT(_state.P, StatusBit::D);
 }
 
 void InstructionDecoder::CLI()
 {
-    CLR_BIT(_cpu._reg_P, StatusBit::I);
+    CLR_BIT(_state.P, StatusBit::I);
 }
 
 void InstructionDecoder::CLV()
 {
-    CLR_BIT(_cpu._reg_P, StatusBit::V);
+    ALU::setOverflow(_state, 0);
 }
 
 void InstructionDecoder::CMP()
 {
     _cpu.read();
-    _cpu._reg_DL = _cpu._reg_A;
-    _alu.CMP();
-    _cpu._reg_A = _cpu._reg_DL;
+    _state.DL = _state.A;
+    ALU::CMP(_state);
+    _state.A = _state.DL;
 }
 
 void InstructionDecoder::CPX()
 {
     _cpu.read();
-    _cpu._reg_DL = _cpu._reg_A;
-    _cpu._reg_A = _cpu._reg_X;
-    _alu.CMP();
-    _cpu._reg_A = _cpu._reg_DL;
+    _state.DL = _state.A;
+    _state.A = _state.X;
+    ALU::CMP(_state);
+    _state.A = _state.DL;
 }
 
 void InstructionDecoder::CPY()
 {
     _cpu.read();
-    _cpu._reg_DL = _cpu._reg_A;
-    _cpu._reg_A = _cpu._reg_Y;
-    _alu.CMP();
-    _cpu._reg_A = _cpu._reg_DL;
+    _state.DL = _state.A;
+    _state.A = _state.Y;
+    ALU::CMP(_state);
+    _state.A = _state.DL;
 }
 
 void InstructionDecoder::DEC()
 {
     _cpu.read();
-    _cpu._reg_DL = _cpu._reg_A;
-    _cpu._reg_A = _cpu._reg_DBB;
-    _alu.DEC();
-    _cpu._reg_DBB = _cpu._reg_A;
-    _cpu._reg_A = _cpu._reg_DL;
+    _state.DL = _state.A;
+    _state.A = _state.DBB;
+    ALU::DEC(_state);
+    _state.DBB = _state.A;
+    _state.A = _state.DL;
     _cpu.write();
 }
 
 void InstructionDecoder::DEX()
 {
-    _cpu._reg_DL = _cpu._reg_A;
-    _cpu._reg_A = _cpu._reg_X;
-    _alu.DEC();
-    _cpu._reg_X = _cpu._reg_A;
-    _cpu._reg_A = _cpu._reg_DL;
+    _state.DL = _state.A;
+    _state.A = _state.X;
+    ALU::DEC(_state);
+    _state.X = _state.A;
+    _state.A = _state.DL;
 }
 
 void InstructionDecoder::DEY()
 {
-    _cpu._reg_DL = _cpu._reg_A;
-    _cpu._reg_A = _cpu._reg_Y;
-    _alu.DEC();
-    _cpu._reg_Y = _cpu._reg_A;
-    _cpu._reg_A = _cpu._reg_DL;
+    _state.DL = _state.A;
+    _state.A = _state.Y;
+    ALU::DEC(_state);
+    _state.Y = _state.A;
+    _state.A = _state.DL;
 }
 
 void InstructionDecoder::EOR()
 {
     _cpu.read();
-    _alu.EOR();
+    ALU::EOR(_state);
 }
 
 void InstructionDecoder::INC()
 {
     _cpu.read();
-    _cpu._reg_DL = _cpu._reg_A;
-    _cpu._reg_A = _cpu._reg_DBB;
-    _alu.INC();
-    _cpu._reg_DBB = _cpu._reg_A;
-    _cpu._reg_A = _cpu._reg_DL;
+    _state.DL = _state.A;
+    _state.A = _state.DBB;
+    ALU::INC(_state);
+    _state.DBB = _state.A;
+    _state.A = _state.DL;
     _cpu.write();
 }
 
 void InstructionDecoder::INX()
 {
-    _cpu._reg_DL = _cpu._reg_A;
-    _cpu._reg_A = _cpu._reg_X;
-    _alu.INC();
-    _cpu._reg_X = _cpu._reg_A;
-    _cpu._reg_A = _cpu._reg_DL;
+    _state.DL = _state.A;
+    _state.A = _state.X;
+    ALU::INC(_state);
+    _state.X = _state.A;
+    _state.A = _state.DL;
 }
 
 void InstructionDecoder::INY()
 {
-    _cpu._reg_DL = _cpu._reg_A;
-    _cpu._reg_A = _cpu._reg_Y;
-    _alu.INC();
-    _cpu._reg_Y = _cpu._reg_A;
-    _cpu._reg_A = _cpu._reg_DL;
+    _state.DL = _state.A;
+    _state.A = _state.Y;
+    ALU::INC(_state);
+    _state.Y = _state.A;
+    _state.A = _state.DL;
 }
 
 void InstructionDecoder::JMP()
 {
     _cpu.read();
-    _cpu._reg_PC = _cpu._reg_AB;
+    _state.PC = _state.AB;
 }
 
 void InstructionDecoder::JSR()
 {
     _cpu.read();
-    --_cpu._reg_PC;
+    --_state.PC;
 
-    reg::splitTwoBytes(_cpu._reg_PC, _cpu._reg_DBB, _cpu._reg_DL);
-    _cpu._reg_PC = _cpu._reg_AB;
+    reg::splitTwoBytes(_state.PC, _state.DBB, _state.DL);
+    _state.PC = _state.AB;
 
     _cpu.push();
-    _cpu._reg_DBB = _cpu._reg_DL;
+    _state.DBB = _state.DL;
     _cpu.push();
 }
 
 void InstructionDecoder::LDA()
 {
     _cpu.read();
-    _alu.setZeroNegative(_cpu._reg_DBB);
-    _cpu._reg_A = _cpu._reg_DBB;
+    ALU::setZeroNegative(_state, _state.DBB);
+    _state.A = _state.DBB;
 }
 
 void InstructionDecoder::LDX()
 {
     _cpu.read();
-    _alu.setZeroNegative(_cpu._reg_DBB);
-    _cpu._reg_X = _cpu._reg_DBB;
+    ALU::setZeroNegative(_state, _state.DBB);
+    _state.X = _state.DBB;
 }
 
 void InstructionDecoder::LDY()
 {
     _cpu.read();
-    _alu.setZeroNegative(_cpu._reg_DBB);
-    _cpu._reg_Y = _cpu._reg_DBB;
+    ALU::setZeroNegative(_state, _state.DBB);
+    _state.Y = _state.DBB;
 }
 
 void InstructionDecoder::LSR()
@@ -468,12 +467,12 @@ void InstructionDecoder::NOP()
 void InstructionDecoder::ORA()
 {
     _cpu.read();
-    _alu.ORA();
+    ALU::ORA(_state);
 }
 
 void InstructionDecoder::PHA()
 {
-    _cpu._reg_DBB = _cpu._reg_A;
+    _state.DBB = _state.A;
     _cpu.push();
 }
 
@@ -481,24 +480,24 @@ void InstructionDecoder::PHP()
 {
     // The break bit is always set, which is not defined
     // in 6502.txt, but is consistent with FCEUX
-    _cpu._reg_DBB = _cpu._reg_P;
-    SEL_BIT(_cpu._reg_DBB, cpu::StatusBit::B);
+    _state.DBB = _cpu.status();
+    SEL_BIT(_state.DBB, cpu::StatusBit::B);
     _cpu.push();
 }
 
 void InstructionDecoder::PLA()
 {
     _cpu.pop();
-    _cpu._reg_A = _cpu._reg_DBB;
-    _alu.setZeroNegative(_cpu._reg_A);
+    _state.A = _state.DBB;
+    ALU::setZeroNegative(_state, _state.A);
 }
 
 void InstructionDecoder::PLP()
 {
     _cpu.pop();
-    SET_BIT(_cpu._reg_DBB, cpu::StatusBit::B,
-            GET_BIT(_cpu._reg_P, cpu::StatusBit::B));
-    _cpu._reg_P = _cpu._reg_DBB | cpu::ClearedStatus;
+    SET_BIT(_state.DBB, cpu::StatusBit::B,
+            GET_BIT(_state.P, cpu::StatusBit::B));
+    _cpu.setStatus(_state.DBB | cpu::ClearedStatus);
 }
 
 void InstructionDecoder::ROL()
@@ -514,90 +513,1313 @@ void InstructionDecoder::ROR()
 void InstructionDecoder::RTI()
 {
     _cpu.pop();
-    _cpu._reg_P = _cpu._reg_DBB | cpu::ClearedStatus;
+    _cpu.setStatus(_state.DBB | cpu::ClearedStatus);
     _cpu.popTwo();
-    reg::mergeTwoBytes(_cpu._reg_PC, _cpu._reg_DBB, _cpu._reg_DL);
+    reg::mergeTwoBytes(_state.PC, _state.DBB, _state.DL);
 }
 
 void InstructionDecoder::RTS()
 {
     _cpu.popTwo();
-    reg::mergeTwoBytes(_cpu._reg_PC, _cpu._reg_DBB, _cpu._reg_DL);
-    ++_cpu._reg_PC;
+    reg::mergeTwoBytes(_state.PC, _state.DBB, _state.DL);
+    ++_state.PC;
 }
 
 void InstructionDecoder::SBC()
 {
     _cpu.read();
-    _alu.SBC();
+    ALU::SBC(_state);
 }
 
 void InstructionDecoder::SEC()
 {
-    SEL_BIT(_cpu._reg_P, StatusBit::C);
+    ALU::setCarry(_state, true);
 }
 
 void InstructionDecoder::SED()
 {
-    SEL_BIT(_cpu._reg_P, StatusBit::D);
+    SEL_BIT(_state.P, StatusBit::D);
 }
 
 void InstructionDecoder::SEI()
 {
-    SEL_BIT(_cpu._reg_P, StatusBit::I);
+    SEL_BIT(_state.P, StatusBit::I);
 }
 
 void InstructionDecoder::STA()
 {
-    _cpu._reg_DBB = _cpu._reg_A;
+    _state.DBB = _state.A;
     _cpu.write();
 }
 
 void InstructionDecoder::STX()
 {
-    _cpu._reg_DBB = _cpu._reg_X;
+    _state.DBB = _state.X;
     _cpu.write();
 }
 
 void InstructionDecoder::STY()
 {
-    _cpu._reg_DBB = _cpu._reg_Y;
+    _state.DBB = _state.Y;
     _cpu.write();
 }
 
 void InstructionDecoder::TAX()
 {
-    _alu.setZeroNegative(_cpu._reg_A);
-    _cpu._reg_X = _cpu._reg_A;
+    ALU::setZeroNegative(_state, _state.A);
+    _state.X = _state.A;
 }
 
 void InstructionDecoder::TAY()
 {
-    _alu.setZeroNegative(_cpu._reg_A);
-    _cpu._reg_Y = _cpu._reg_A;
+    ALU::setZeroNegative(_state, _state.A);
+    _state.Y = _state.A;
 }
 
 void InstructionDecoder::TSX()
 {
-    _alu.setZeroNegative(_cpu._reg_S);
-    _cpu._reg_X = _cpu._reg_S;
+    ALU::setZeroNegative(_state, _state.S);
+    _state.X = _state.S;
 }
 
 void InstructionDecoder::TXA()
 {
-    _alu.setZeroNegative(_cpu._reg_X);
-    _cpu._reg_A = _cpu._reg_X;
+    ALU::setZeroNegative(_state, _state.X);
+    _state.A = _state.X;
 }
 
 void InstructionDecoder::TXS()
 {
-    _cpu._reg_S = _cpu._reg_X;
+    _state.S = _state.X;
 }
 
 void InstructionDecoder::TYA()
 {
-    _alu.setZeroNegative(_cpu._reg_Y);
-    _cpu._reg_A = _cpu._reg_Y;
+    ALU::setZeroNegative(_state, _state.Y);
+    _state.A = _state.Y;
+}
+
+/* FusedCore */
+
+/**
+ * @brief Handlers built from the operation descriptions
+ *
+ * Each op code gets its own handler, with the addressing mode,
+ * the instruction and the cycles known at compile time, so
+ * the switches below fold into the straight-line code of one
+ * operation, without the register shuffling of the decoder
+ */
+class FusedCore
+{
+
+public:
+
+    typedef void (*Handler)(tones::MicroProcessor &cpu);
+
+    //! Handlers indexed by op code
+    static const Handler Handlers[OperationSetSize];
+
+    //! Handlers indexed by op code, with the operands predecoded
+    static const CacheEntry_t::Handler CachedHandlers[OperationSetSize];
+
+    //! Run one instruction out of the predecoded instruction cache
+    static void runCached(tones::MicroProcessor &cpu);
+
+    //! Run one instruction fetched from the bus
+    static inline void runFetched(tones::MicroProcessor &cpu);
+
+    //! Drop the predecoded instructions if the bus is remapped
+    static inline void validate(tones::MicroProcessor &cpu);
+
+    //! Host memory only read, and not memory with its writes watched
+    static inline bool isReadOnly(const Page_t &page);
+
+    //! Steps of the blocks, indexed by op code
+    static const jit::Step Steps[OperationSetSize];
+
+    //! Run instructions in a row as one step, returns their ticks
+    template <int Code>
+    static int fuse(tones::MicroProcessor &cpu, const uint8_t *operands);
+
+    template <int Code, int Next, int... Rest>
+    static int fuse(tones::MicroProcessor &cpu, const uint8_t *operands);
+
+    static constexpr int operandsOf(code::AddressingKind_t mode);
+
+protected:
+
+    template <int Code, bool Predecoded>
+    static void run(tones::MicroProcessor &cpu, const uint8_t *operands);
+
+    template <int Code>
+    static void run(tones::MicroProcessor &cpu);
+
+    //! Run a predecoded instruction of a compiled block
+    template <int Code>
+    static int step(tones::MicroProcessor &cpu, const uint8_t *operands);
+
+    static void unknown(tones::MicroProcessor &cpu);
+
+    static void unknown(tones::MicroProcessor &cpu, const uint8_t *operands);
+
+    //! Decode the instruction at the host memory into the cache
+    static void fill(tones::MicroProcessor &cpu, CacheEntry_t &entry, const uint8_t *host);
+
+    template <code::AddressingKind_t Mode, bool Predecoded>
+    static inline void fetch(tones::MicroProcessor &cpu, const uint8_t *operands);
+
+    template <bool Predecoded>
+    static inline void fetchOne(tones::MicroProcessor &cpu, const uint8_t *operands);
+
+    template <bool Predecoded>
+    static inline void fetchTwo(tones::MicroProcessor &cpu, const uint8_t *operands);
+
+    template <code::InstructionKind_t Type, code::AddressingKind_t Mode, bool Predecoded>
+    static inline void execute(tones::MicroProcessor &cpu);
+
+    //! Read the operand, unless it is predecoded already
+    template <code::AddressingKind_t Mode, bool Predecoded>
+    static inline void load(tones::MicroProcessor &cpu);
+
+    /* Helper Functions */
+
+    static inline void setZeroNegative(tones::MicroProcessor &cpu, uint8_t value);
+
+    static inline void compare(tones::MicroProcessor &cpu, uint8_t reg);
+
+    //! Shift or rotate the accumulator or the memory in place
+    template <code::InstructionKind_t Type, code::AddressingKind_t Mode, bool Predecoded>
+    static inline void shift(tones::MicroProcessor &cpu);
+};
+
+template <int Code, bool Predecoded>
+void FusedCore::run(tones::MicroProcessor &cpu, const uint8_t *operands)
+{
+    const code::AddressingKind_t mode = OperationDescriptions[Code].mode;
+
+    cpu._state.skip = OperationDescriptions[Code].cycles;
+    fetch<mode, Predecoded>(cpu, operands);
+    execute<OperationDescriptions[Code].type, mode, Predecoded>(cpu);
+}
+
+template <int Code>
+void FusedCore::run(tones::MicroProcessor &cpu)
+{
+    run<Code, false>(cpu, nullptr);
+}
+
+template <int Code>
+int FusedCore::step(tones::MicroProcessor &cpu, const uint8_t *operands)
+{
+    cpu._state.AB = cpu._state.PC++;
+    cpu._state.DBB = Code;
+    cpu._state.IR = Code;
+    run<Code, true>(cpu, operands);
+
+    return cpu._state.skip + 1;
+}
+
+template <int Code>
+int FusedCore::fuse(tones::MicroProcessor &cpu, const uint8_t *operands)
+{
+    return step<Code>(cpu, operands);
+}
+
+template <int Code, int Next, int... Rest>
+int FusedCore::fuse(tones::MicroProcessor &cpu, const uint8_t *operands)
+{
+    int ticks = step<Code>(cpu, operands);
+    return ticks + fuse<Next, Rest...>(cpu, operands + operandsOf(OperationDescriptions[Code].mode));
+}
+
+constexpr int FusedCore::operandsOf(code::AddressingKind_t mode)
+{
+    return mode == code::Implied || mode == code::Accumulator ? 0 :
+           mode == code::Absolute || mode == code::AbsoluteIndirect ||
+           mode == code::IndexedAbsoluteX || mode == code::IndexedAbsoluteY ? 2 : 1;
+}
+
+void FusedCore::unknown(tones::MicroProcessor &cpu)
+{
+    cpu._state.skip = 0;
+}
+
+void FusedCore::unknown(tones::MicroProcessor &cpu, const uint8_t *)
+{
+    cpu._state.skip = 0;
+}
+
+void FusedCore::runCached(tones::MicroProcessor &cpu)
+{
+#ifndef TONES_BUS_TRACE
+    // Only code in read-only host memory is cached, which is
+    // changed by remapping its page only, like switching banks
+    const Page_t &page = cpu._bus.page(cpu._state.PC);
+    if (isReadOnly(page)) {
+        validate(cpu);
+
+        // Tagged by the host memory, for the same PC in each bank
+        const uint8_t *host = page.rbase + (cpu._state.PC & page.mask);
+        CacheEntry_t &entry = cpu._cache[cpu._state.PC & InstructionCacheMask];
+        if (entry.tag != host)
+            fill(cpu, entry, host);
+
+        ++cpu._state.instructions;
+        cpu._state.AB = cpu._state.PC++;
+        cpu._state.DBB = entry.opcode;
+        cpu._state.IR = entry.opcode;
+        entry.handler(cpu, entry.operands);
+        return;
+    }
+#endif
+
+    // Code in RAM, decoded each time
+    runFetched(cpu);
+}
+
+inline void FusedCore::runFetched(tones::MicroProcessor &cpu)
+{
+    ++cpu._state.instructions;
+    cpu._state.AB = cpu._state.PC++;
+    cpu.read();
+    cpu._state.IR = cpu._state.DBB;
+    Handlers[cpu._state.IR](cpu);
+}
+
+inline bool FusedCore::isReadOnly(const Page_t &page)
+{
+    return page.rbase && !page.wbase && !(page.watch & static_cast<uint8_t>(Access::Write));
+}
+
+inline void FusedCore::validate(tones::MicroProcessor &cpu)
+{
+    if (cpu._cacheGeneration == cpu._bus.generation())
+        return;
+
+    cpu._cacheGeneration = cpu._bus.generation();
+    for (auto &entry : cpu._cache)
+        entry.tag = nullptr;
+
+    for (auto &block : cpu._blocks) {
+        block.tag = nullptr;
+        block.writable = false;
+    }
+    cpu._codePages.fill(0);
+
+    if (cpu._jit)
+        cpu._jit->reset();
+}
+
+void FusedCore::fill(tones::MicroProcessor &cpu, CacheEntry_t &entry, const uint8_t *host)
+{
+    entry.tag = host;
+    entry.opcode = host[0];
+    entry.handler = CachedHandlers[entry.opcode];
+
+    int operands = OperationSet[entry.opcode]->mode->operands;
+    for (int i = 0; i < operands; ++i)
+        cpu._bus.peek(cpu._state.PC + 1 + i, entry.operands[i]);
+}
+
+template <bool Predecoded>
+inline void FusedCore::fetchOne(tones::MicroProcessor &cpu, const uint8_t *operands)
+{
+    if (Predecoded) {
+        cpu._state.AB = cpu._state.PC++;
+        cpu._state.DBB = operands[0];
+    } else {
+        cpu.fetchOne();
+    }
+}
+
+template <bool Predecoded>
+inline void FusedCore::fetchTwo(tones::MicroProcessor &cpu, const uint8_t *operands)
+{
+    if (Predecoded) {
+        cpu._state.DL = operands[0];
+        cpu._state.DBB = operands[1];
+        ++cpu._state.PC;
+        cpu._state.AB = cpu._state.PC++;
+    } else {
+        cpu.fetchTwo();
+    }
+}
+
+template <code::AddressingKind_t Mode, bool Predecoded>
+inline void FusedCore::fetch(tones::MicroProcessor &cpu, const uint8_t *operands)
+{
+    // Same steps as the fetchers of MicroProcessor
+    switch (Mode) {
+        case code::Implied:
+        case code::Accumulator:
+            break;
+
+        case code::Immediate:
+            if (Predecoded)
+                cpu._state.DBB = operands[0];
+            cpu._state.AB = cpu._state.PC++;
+            break;
+
+        case code::Absolute:
+            fetchTwo<Predecoded>(cpu, operands);
+            reg::mergeTwoBytes(cpu._state.AB, cpu._state.DBB, cpu._state.DL);
+            break;
+
+        case code::ZeroPage:
+            fetchOne<Predecoded>(cpu, operands);
+            cpu._state.AB = cpu._state.DBB;
+            break;
+
+        case code::IndexedZeroPageX:
+            fetchOne<Predecoded>(cpu, operands);
+            cpu._state.AB = (uint8_t)(cpu._state.DBB + cpu._state.X);
+            break;
+
+        case code::IndexedZeroPageY:
+            fetchOne<Predecoded>(cpu, operands);
+            cpu._state.AB = (uint8_t)(cpu._state.DBB + cpu._state.Y);
+            break;
+
+        case code::IndexedAbsoluteX:
+            fetchTwo<Predecoded>(cpu, operands);
+            reg::mergeTwoBytes(cpu._state.AB, cpu._state.DBB, cpu._state.DL);
+            cpu._state.AB += cpu._state.X;
+            break;
+
+        case code::IndexedAbsoluteY:
+            fetchTwo<Predecoded>(cpu, operands);
+            reg::mergeTwoBytes(cpu._state.AB, cpu._state.DBB, cpu._state.DL);
+            cpu._state.AB += cpu._state.Y;
+            break;
+
+        case code::Relative:
+            fetchOne<Predecoded>(cpu, operands);
+            break;
+
+        case code::IndexedIndirect:
+            fetchOne<Predecoded>(cpu, operands);
+            cpu._state.AB = (uint8_t)(cpu._state.DBB + cpu._state.X);
+            cpu.read(cpu._zeroPage);
+            cpu._state.DL = cpu._state.DBB;
+            cpu._state.AB = (cpu._state.AB + 1) & 0xff;
+            cpu.read(cpu._zeroPage);
+            reg::mergeTwoBytes(cpu._state.AB, cpu._state.DBB, cpu._state.DL);
+            break;
+
+        case code::IndirectIndexed:
+            fetchOne<Predecoded>(cpu, operands);
+            cpu._state.AB = cpu._state.DBB;
+            cpu.read(cpu._zeroPage);
+            cpu._state.DL = cpu._state.DBB;
+            cpu._state.AB = (cpu._state.AB + 1) & 0xff;
+            cpu.read(cpu._zeroPage);
+            reg::mergeTwoBytes(cpu._state.AB, cpu._state.DBB, cpu._state.DL);
+            cpu._state.AB += cpu._state.Y;
+            break;
+
+        case code::AbsoluteIndirect:
+            fetchTwo<Predecoded>(cpu, operands);
+            reg::mergeTwoBytes(cpu._state.AB, cpu._state.DBB, cpu._state.DL);
+            cpu.read();
+            cpu._state.DL = cpu._state.DBB;
+            cpu._state.AB = (cpu._state.AB & 0xff00) | ((cpu._state.AB + 1) & 0xff); // page wrap bug
+            cpu.read();
+            reg::mergeTwoBytes(cpu._state.AB, cpu._state.DBB, cpu._state.DL);
+            break;
+    }
+}
+
+template <code::AddressingKind_t Mode, bool Predecoded>
+inline void FusedCore::load(tones::MicroProcessor &cpu)
+{
+    // Immediate and relative operands are in DBB after fetching
+    if (!Predecoded || (Mode != code::Immediate && Mode != code::Relative))
+        cpu.read();
+}
+
+template <code::InstructionKind_t Type, code::AddressingKind_t Mode, bool Predecoded>
+inline void FusedCore::execute(tones::MicroProcessor &cpu)
+{
+    // Same bus accesses and results as the decoder
+    switch (Type) {
+        /* Load & Store */
+        case code::LDA: load<Mode, Predecoded>(cpu); cpu._state.A = cpu._state.DBB; setZeroNegative(cpu, cpu._state.A); break;
+        case code::LDX: load<Mode, Predecoded>(cpu); cpu._state.X = cpu._state.DBB; setZeroNegative(cpu, cpu._state.X); break;
+        case code::LDY: load<Mode, Predecoded>(cpu); cpu._state.Y = cpu._state.DBB; setZeroNegative(cpu, cpu._state.Y); break;
+        case code::STA: cpu._state.DBB = cpu._state.A; cpu.write(); break;
+        case code::STX: cpu._state.DBB = cpu._state.X; cpu.write(); break;
+        case code::STY: cpu._state.DBB = cpu._state.Y; cpu.write(); break;
+
+        /* Register Transfers */
+        case code::TAX: cpu._state.X = cpu._state.A; setZeroNegative(cpu, cpu._state.X); break;
+        case code::TAY: cpu._state.Y = cpu._state.A; setZeroNegative(cpu, cpu._state.Y); break;
+        case code::TXA: cpu._state.A = cpu._state.X; setZeroNegative(cpu, cpu._state.A); break;
+        case code::TYA: cpu._state.A = cpu._state.Y; setZeroNegative(cpu, cpu._state.A); break;
+
+        /* Stack Instructions */
+        case code::TSX: cpu._state.X = cpu._state.S; setZeroNegative(cpu, cpu._state.X); break;
+        case code::TXS: cpu._state.S = cpu._state.X; break;
+        case code::PHA: cpu._state.DBB = cpu._state.A; cpu.push(); break;
+        case code::PHP:
+            cpu._state.DBB = cpu.status() | static_cast<uint8_t>(StatusBit::B);
+            cpu.push();
+            break;
+        case code::PLA: cpu.pop(); cpu._state.A = cpu._state.DBB; setZeroNegative(cpu, cpu._state.A); break;
+        case code::PLP:
+            cpu.pop();
+            SET_BIT(cpu._state.DBB, StatusBit::B, GET_BIT(cpu._state.P, StatusBit::B));
+            cpu.setStatus(cpu._state.DBB | ClearedStatus);
+            break;
+
+        /* Status Instructions */
+        case code::CLC: cpu._state.flags.C = 0; break;
+        case code::CLD: CLR_BIT(cpu._state.P, StatusBit::D); break;
+        case code::CLI: CLR_BIT(cpu._state.P, StatusBit::I); break;
+        case code::CLV: cpu._state.flags.V = 0; break;
+        case code::SEC: cpu._state.flags.C = 1; break;
+        case code::SED: SEL_BIT(cpu._state.P, StatusBit::D); break;
+        case code::SEI: SEL_BIT(cpu._state.P, StatusBit::I); break;
+
+        /* Shift Instructions */
+        case code::LSR:
+            load<Mode, Predecoded>(cpu); // as InstructionDecoder::LSR, then shift
+            // fall through
+        case code::ASL:
+        case code::ROL:
+        case code::ROR:
+            shift<Type, Mode, Predecoded>(cpu);
+            break;
+
+        /* Increments & Decrements */
+        case code::INC: load<Mode, Predecoded>(cpu); ++cpu._state.DBB; setZeroNegative(cpu, cpu._state.DBB); cpu.write(); break;
+        case code::DEC: load<Mode, Predecoded>(cpu); --cpu._state.DBB; setZeroNegative(cpu, cpu._state.DBB); cpu.write(); break;
+        case code::INX: ++cpu._state.X; setZeroNegative(cpu, cpu._state.X); break;
+        case code::DEX: --cpu._state.X; setZeroNegative(cpu, cpu._state.X); break;
+        case code::INY: ++cpu._state.Y; setZeroNegative(cpu, cpu._state.Y); break;
+        case code::DEY: --cpu._state.Y; setZeroNegative(cpu, cpu._state.Y); break;
+
+        /* Logical Instructions */
+        case code::AND: load<Mode, Predecoded>(cpu); ALU::AND(cpu._state); break;
+        case code::EOR: load<Mode, Predecoded>(cpu); ALU::EOR(cpu._state); break;
+        case code::ORA: load<Mode, Predecoded>(cpu); ALU::ORA(cpu._state); break;
+        case code::BIT:
+            load<Mode, Predecoded>(cpu);
+            cpu._state.flags.N = cpu._state.DBB;
+            cpu._state.flags.V = cpu._state.DBB << 1;
+            cpu._state.flags.Z = cpu._state.DBB & cpu._state.A;
+            break;
+
+        /* Arithmetic Instructions */
+        case code::ADC: load<Mode, Predecoded>(cpu); ALU::ADC(cpu._state); break;
+        case code::SBC: load<Mode, Predecoded>(cpu); ALU::SBC(cpu._state); break;
+        case code::CMP: load<Mode, Predecoded>(cpu); compare(cpu, cpu._state.A); break;
+        case code::CPX: load<Mode, Predecoded>(cpu); compare(cpu, cpu._state.X); break;
+        case code::CPY: load<Mode, Predecoded>(cpu); compare(cpu, cpu._state.Y); break;
+
+        /* Jumps & Calls */
+        case code::JMP: load<Mode, Predecoded>(cpu); cpu._state.PC = cpu._state.AB; break;
+        case code::JSR:
+            load<Mode, Predecoded>(cpu);
+            --cpu._state.PC;
+            reg::splitTwoBytes(cpu._state.PC, cpu._state.DBB, cpu._state.DL);
+            cpu._state.PC = cpu._state.AB;
+            cpu.push();
+            cpu._state.DBB = cpu._state.DL;
+            cpu.push();
+            break;
+        case code::RTS:
+            cpu.popTwo();
+            reg::mergeTwoBytes(cpu._state.PC, cpu._state.DBB, cpu._state.DL);
+            ++cpu._state.PC;
+            break;
+
+        /* Branch Instructions */
+        case code::BCC: load<Mode, Predecoded>(cpu); if (!cpu._state.flags.C) cpu.branch(); break;
+        case code::BCS: load<Mode, Predecoded>(cpu); if (cpu._state.flags.C) cpu.branch(); break;
+        case code::BEQ: load<Mode, Predecoded>(cpu); if (!cpu._state.flags.Z) cpu.branch(); break;
+        case code::BMI: load<Mode, Predecoded>(cpu); if (cpu._state.flags.N & 0x80) cpu.branch(); break;
+        case code::BNE: load<Mode, Predecoded>(cpu); if (cpu._state.flags.Z) cpu.branch(); break;
+        case code::BPL: load<Mode, Predecoded>(cpu); if (!(cpu._state.flags.N & 0x80)) cpu.branch(); break;
+        case code::BVC: load<Mode, Predecoded>(cpu); if (!(cpu._state.flags.V & 0x80)) cpu.branch(); break;
+        case code::BVS: load<Mode, Predecoded>(cpu); if (cpu._state.flags.V & 0x80) cpu.branch(); break;
+
+        /* System Functions */
+        case code::BRK:
+            ++cpu._state.PC; // 6502 quirk
+            SEL_BIT(cpu._state.P, StatusBit::B);
+            cpu.interrupt(VectorIRQ);
+            CLR_BIT(cpu._state.P, StatusBit::B);
+            break;
+        case code::NOP:
+            break;
+        case code::RTI:
+            cpu.pop();
+            cpu.setStatus(cpu._state.DBB | ClearedStatus);
+            cpu.popTwo();
+            reg::mergeTwoBytes(cpu._state.PC, cpu._state.DBB, cpu._state.DL);
+            break;
+    }
+}
+
+inline void FusedCore::setZeroNegative(tones::MicroProcessor &cpu, uint8_t value)
+{
+    cpu._state.flags.N = value;
+    cpu._state.flags.Z = value;
+}
+
+inline void FusedCore::compare(tones::MicroProcessor &cpu, uint8_t reg)
+{
+    uint16_t tmp = reg - cpu._state.DBB;
+    cpu._state.flags.C = !(tmp & 0x100);
+    setZeroNegative(cpu, tmp);
+}
+
+template <code::InstructionKind_t Type, code::AddressingKind_t Mode, bool Predecoded>
+inline void FusedCore::shift(tones::MicroProcessor &cpu)
+{
+    uint8_t value;
+    if (Mode == code::Accumulator) {
+        value = cpu._state.A;
+    } else {
+        load<Mode, Predecoded>(cpu);
+        value = cpu._state.DBB;
+    }
+
+    uint8_t carry = cpu._state.flags.C;
+    switch (Type) {
+        case code::ASL: cpu._state.flags.C = value >> 7; value <<= 1; break;
+        case code::LSR: cpu._state.flags.C = value & 0x01; value >>= 1; break;
+        case code::ROL:
+            cpu._state.flags.C = value >> 7;
+            value = (value << 1) | carry;
+            break;
+        case code::ROR:
+            cpu._state.flags.C = value & 0x01;
+            value = (value >> 1) | (carry << 7);
+            break;
+        default:
+            break;
+    }
+    setZeroNegative(cpu, value);
+
+    if (Mode == code::Accumulator) {
+        cpu._state.A = value;
+        cpu._state.DBB = value;
+    } else {
+        cpu._state.DBB = value;
+        cpu.write();
+    }
+}
+
+#define FUSED_HANDLER(op, type, mode, cycles) &FusedCore::run<op>,
+#define FUSED_UNKNOWN(op) &FusedCore::unknown,
+
+const FusedCore::Handler FusedCore::Handlers[OperationSetSize] = {
+    TONES_OPERATION_SET(FUSED_HANDLER, FUSED_UNKNOWN)
+};
+
+#define CACHED_HANDLER(op, type, mode, cycles) &FusedCore::run<op, true>,
+#define CACHED_UNKNOWN(op) &FusedCore::unknown,
+
+const CacheEntry_t::Handler FusedCore::CachedHandlers[OperationSetSize] = {
+    TONES_OPERATION_SET(CACHED_HANDLER, CACHED_UNKNOWN)
+};
+
+// Unknown op codes never get into blocks
+#define STEP_HANDLER(op, type, mode, cycles) &FusedCore::step<op>,
+#define STEP_UNKNOWN(op) nullptr,
+
+const jit::Step FusedCore::Steps[OperationSetSize] = {
+    TONES_OPERATION_SET(STEP_HANDLER, STEP_UNKNOWN)
+};
+
+/* BlockCore */
+
+/**
+ * @brief Threaded code of basic blocks
+ *
+ * A block runs at the first tick of its first instruction and the
+ * CPU waits for the cycles of the whole block after it. So, only
+ * accesses to memory may be moved earlier than they are, anything
+ * which may touch a device is left to the next step, and it runs
+ * alone, at the exact tick.
+ */
+class BlockCore
+{
+
+public:
+
+    //! Run one basic block, or one instruction out of blocks
+    template <bool Native>
+    static void run(tones::MicroProcessor &cpu);
+
+protected:
+
+    //! Steps run as one, most frequent in games
+    typedef struct Superinstruction {
+        int length;
+        uint8_t opcodes[3];
+        jit::Step run;
+    } Superinstruction_t;
+
+    static const Superinstruction_t Superinstructions[];
+
+    //! Run the steps of a block one by one, returns the ticks
+    static inline int interpret(tones::MicroProcessor &cpu, const Block_t &block);
+
+    //! Run the compiled code of a block, compiling it once it is hot
+    static inline int execute(tones::MicroProcessor &cpu, Block_t &block);
+
+    //! Decode the block at PC
+    static void translate(tones::MicroProcessor &cpu, Block_t &block, const uint8_t *host);
+
+    //! Replace the instructions in a row with superinstructions
+    static void fuse(Block_t &block);
+
+    //! Whether an instruction only reads what reads the same each time
+    static bool isPure(tones::MicroProcessor &cpu, const BlockStep_t &step);
+
+    //! Skip the iterations of an idle loop, which are all the same
+    static inline void fastForward(tones::MicroProcessor &cpu, const Block_t &block, int ticks);
+
+    //! Kinds of accesses of an instruction which may reach anything other than memory
+    static uint8_t deviceAccess(tones::MicroProcessor &cpu, const BlockStep_t &step);
+
+    //! Whether the page of an address is memory for the accesses
+    static inline bool isMemory(tones::MicroProcessor &cpu, uint16_t address, uint8_t access);
+
+    //! Whether an instruction changes the flow of control
+    static inline bool endsBlock(code::InstructionKind_t type);
+
+    //! RAM the native dispatch runs blocks from, but the zero page and the stack
+    static inline bool isWritableCode(tones::MicroProcessor &cpu, uint16_t address);
+
+    //! Drop the blocks in RAM on writes to the host memory of an address, from any page
+    static void watchCode(tones::MicroProcessor &cpu, uint16_t address);
+
+    //! Whether an instruction writes to memory, but the stack
+    static inline bool writesMemory(const Description_t &description);
+};
+
+// The idioms of games, and the hottest pairs of the profiler on
+// nestest. The longer ones first, ends with a null one
+const BlockCore::Superinstruction_t BlockCore::Superinstructions[] = {
+    { 3, { 0xc8, 0xc0, 0xd0 }, &FusedCore::fuse<0xc8, 0xc0, 0xd0> }, // INY / CPY # / BNE
+    { 3, { 0xe8, 0xe0, 0xd0 }, &FusedCore::fuse<0xe8, 0xe0, 0xd0> }, // INX / CPX # / BNE
+    { 2, { 0xa5, 0x8d },       &FusedCore::fuse<0xa5, 0x8d> },       // LDA ZP / STA ABS
+    { 2, { 0xbd, 0x9d },       &FusedCore::fuse<0xbd, 0x9d> },       // LDA ABS, X / STA ABS, X
+    { 2, { 0xb9, 0x99 },       &FusedCore::fuse<0xb9, 0x99> },       // LDA ABS, Y / STA ABS, Y
+    { 2, { 0xca, 0xd0 },       &FusedCore::fuse<0xca, 0xd0> },       // DEX / BNE
+    { 2, { 0x88, 0xd0 },       &FusedCore::fuse<0x88, 0xd0> },       // DEY / BNE
+    { 2, { 0x2c, 0x10 },       &FusedCore::fuse<0x2c, 0x10> },       // BIT ABS / BPL
+    { 2, { 0xc9, 0xd0 },       &FusedCore::fuse<0xc9, 0xd0> },       // CMP # / BNE
+    { 2, { 0xa9, 0x8d },       &FusedCore::fuse<0xa9, 0x8d> },       // LDA # / STA ABS
+    { 2, { 0xa9, 0x85 },       &FusedCore::fuse<0xa9, 0x85> },       // LDA # / STA ZP
+    { 0, { 0 }, nullptr },
+};
+
+template <bool Native>
+void BlockCore::run(tones::MicroProcessor &cpu)
+{
+#ifndef TONES_BUS_TRACE
+    const Page_t &page = cpu._bus.page(cpu._state.PC);
+    if (FusedCore::isReadOnly(page) || (Native && isWritableCode(cpu, cpu._state.PC))) {
+        FusedCore::validate(cpu);
+
+        // Tagged like the instruction cache
+        const uint8_t *host = page.rbase + (cpu._state.PC & page.mask);
+        Block_t &block = cpu._blocks[cpu._state.PC & InstructionCacheMask];
+        if (block.tag != host)
+            translate(cpu, block, host);
+
+        if (!block.steps.empty()) {
+            uint8_t registers[] = { cpu._state.A, cpu._state.X, cpu._state.Y, cpu._state.S, cpu.status() };
+            uint64_t instructions = cpu._state.instructions;
+
+            int ticks = Native ? execute(cpu, block) : interpret(cpu, block);
+
+            // This tick is the first one of the block
+            cpu._state.skip = ticks - 1;
+            cpu._state.instructions += block.instructions;
+
+            // The same state after an iteration, as the one before
+            if (block.idle && cpu._state.A == registers[0] && cpu._state.X == registers[1] &&
+                cpu._state.Y == registers[2] && cpu._state.S == registers[3] && cpu.status() == registers[4]) {
+                // The first read of MMIO may still change it, like the
+                // vblank flag, so confirm it with the next iteration
+                if (cpu._idleMark == instructions && cpu._idleEntry == cpu._state.PC)
+                    fastForward(cpu, block, ticks);
+
+                cpu._idleMark = cpu._state.instructions;
+                cpu._idleEntry = cpu._state.PC;
+            }
+            return;
+        }
+    }
+#endif
+
+    FusedCore::runFetched(cpu);
+}
+
+inline int BlockCore::interpret(tones::MicroProcessor &cpu, const Block_t &block)
+{
+    int ticks = 0;
+    for (const BlockStep_t &step : block.steps)
+        ticks += step.run(cpu, step.operands);
+
+    return ticks;
+}
+
+inline int BlockCore::execute(tones::MicroProcessor &cpu, Block_t &block)
+{
+    if (block.native)
+        return block.native(cpu);
+
+    if (++block.runs < jit::HotThreshold)
+        return interpret(cpu, block);
+
+    block.runs = 0;
+    block.native = cpu._jit->compile(cpu, block, cpu._state.PC);
+
+    // Out of space, start over with the hot blocks from now on
+    if (!block.native && cpu._jit->size()) {
+        for (auto &entry : cpu._blocks) {
+            entry.native = nullptr;
+            entry.runs = 0;
+        }
+
+        cpu._jit->reset();
+        block.native = cpu._jit->compile(cpu, block, cpu._state.PC);
+    }
+
+    return block.native ? block.native(cpu) : interpret(cpu, block);
+}
+
+void BlockCore::translate(tones::MicroProcessor &cpu, Block_t &block, const uint8_t *host)
+{
+    uint16_t address = cpu._state.PC;
+
+    block.tag = host;
+    block.steps.clear();
+    block.instructions = 0;
+    block.idle = false;
+    block.runs = 0;
+    block.native = nullptr;
+
+    // The compiler translates the instructions one by one
+    bool native = cpu._dispatch == Dispatch::Native;
+    block.writable = native && isWritableCode(cpu, address);
+
+    bool pure = true;
+    while (block.instructions < BlockMaxLength) {
+        const Page_t &page = cpu._bus.page(address);
+        if (block.writable ? !isWritableCode(cpu, address) : !FusedCore::isReadOnly(page))
+            break;
+
+        BlockStep_t step = { nullptr, 0, 1, { 0, 0, 0, 0 } };
+        cpu._bus.peek(address, step.opcode);
+
+        const Description_t &description = OperationDescriptions[step.opcode];
+        if (!description.known)
+            break;
+
+        int operands = OperationSet[step.opcode]->mode->operands;
+        for (int i = 0; i < operands; ++i)
+            cpu._bus.peek(address + 1 + i, step.operands[i]);
+
+        // The first instruction runs at its exact tick, but a write
+        // may switch the banks under the rest of the block
+        uint8_t access = deviceAccess(cpu, step);
+        if (access && (block.instructions || (access & static_cast<uint8_t>(Access::Write))))
+            break;
+
+        if (block.writable && !isWritableCode(cpu, address + operands))
+            break;
+
+        step.run = FusedCore::Steps[step.opcode];
+        block.steps.push_back(step);
+        ++block.instructions;
+        pure = pure && isPure(cpu, step);
+
+        if (block.writable) {
+            watchCode(cpu, address);
+            if ((address >> PageShift) != ((address + operands) >> PageShift))
+                watchCode(cpu, address + operands);
+
+            // A write may change the code after it
+            if (writesMemory(description))
+                break;
+        }
+
+        if (endsBlock(description.type)) {
+            // A branch or a jump back to the entry
+            uint16_t target;
+            if (description.mode == code::Relative)
+                target = address + 2 + (int8_t)step.operands[0];
+            else
+                reg::mergeTwoBytes(target, step.operands[1], step.operands[0]);
+
+            bool loop = description.mode == code::Relative ||
+                        (description.type == code::JMP && description.mode == code::Absolute);
+            block.idle = pure && loop && target == cpu._state.PC;
+            break;
+        }
+
+        address += 1 + operands;
+    }
+
+    if (!native)
+        fuse(block);
+}
+
+void BlockCore::fuse(Block_t &block)
+{
+    std::vector<BlockStep_t> &steps = block.steps;
+
+    // In place, as the fused steps are never more than the read ones
+    int count = 0;
+    for (int i = 0; i < (int)steps.size(); ) {
+        const Superinstruction_t *fused = nullptr;
+        for (const Superinstruction_t *super = Superinstructions; super->run && !fused; ++super) {
+            if (i + super->length > (int)steps.size())
+                continue;
+
+            fused = super;
+            for (int j = 0; j < super->length && fused; ++j) {
+                if (steps[i + j].opcode != super->opcodes[j])
+                    fused = nullptr;
+            }
+        }
+
+        if (!fused) {
+            steps[count++] = steps[i++];
+            continue;
+        }
+
+        BlockStep_t step = { fused->run, fused->opcodes[0], (uint8_t)fused->length, { 0, 0, 0, 0 } };
+        int operands = 0;
+        for (int j = 0; j < fused->length; ++j, ++i) {
+            for (int k = 0; k < OperationSet[steps[i].opcode]->mode->operands; ++k)
+                step.operands[operands++] = steps[i].operands[k];
+        }
+
+        steps[count++] = step;
+    }
+
+    steps.resize(count);
+}
+
+bool BlockCore::isPure(tones::MicroProcessor &cpu, const BlockStep_t &step)
+{
+    const Description_t &description = OperationDescriptions[step.opcode];
+
+    switch (description.type) {
+        case code::STA: case code::STX: case code::STY:
+        case code::PHA: case code::PHP: case code::JSR: case code::BRK:
+        case code::RTS: case code::RTI:
+            return false;
+
+        case code::ASL: case code::LSR: case code::ROL: case code::ROR:
+        case code::INC: case code::DEC:
+            return description.mode == code::Accumulator;
+
+        default:
+            break;
+    }
+
+    if (!(deviceAccess(cpu, step) & static_cast<uint8_t>(Access::Read)))
+        return true;
+
+    // Reads the status of a device
+    uint16_t address;
+    reg::mergeTwoBytes(address, step.operands[1], step.operands[0]);
+    return description.mode == code::Absolute && cpu._bus.stable(address);
+}
+
+inline void BlockCore::fastForward(tones::MicroProcessor &cpu, const Block_t &block, int ticks)
+{
+    if (!cpu._horizon)
+        return;
+
+    // Iterations whose reads are all before the horizon
+    uint32_t horizon = std::min<uint32_t>(cpu._horizon(), UINT16_MAX - cpu._state.skip);
+    uint32_t iterations = horizon / ticks;
+
+    cpu._state.skip += iterations * ticks;
+    cpu._state.instructions += iterations * block.instructions;
+}
+
+uint8_t BlockCore::deviceAccess(tones::MicroProcessor &cpu, const BlockStep_t &step)
+{
+    const Description_t &description = OperationDescriptions[step.opcode];
+
+    uint8_t access;
+    switch (description.type) {
+        case code::STA:
+        case code::STX:
+        case code::STY:
+            access = static_cast<uint8_t>(Access::Write);
+            break;
+
+        case code::ASL:
+        case code::LSR:
+        case code::ROL:
+        case code::ROR:
+        case code::INC:
+        case code::DEC:
+            access = static_cast<uint8_t>(Access::Read) | static_cast<uint8_t>(Access::Write);
+            break;
+
+        case code::JMP:
+        case code::JSR:
+            // Jump to the address, rather than access it
+            if (description.mode == code::Absolute)
+                return 0;
+            // Fall through
+
+        default:
+            access = static_cast<uint8_t>(Access::Read);
+            break;
+    }
+
+    uint16_t address;
+    reg::mergeTwoBytes(address, step.operands[1], step.operands[0]);
+
+    switch (description.mode) {
+        case code::Implied:
+            // Fetch the break vector
+            if (description.type == code::BRK)
+                return isMemory(cpu, cpu::VectorIRQ, access) ? 0 : access;
+            return 0;
+
+        case code::Accumulator:
+        case code::Immediate:
+        case code::Relative:
+            return 0;
+
+        case code::ZeroPage:
+        case code::IndexedZeroPageX:
+        case code::IndexedZeroPageY:
+            return isMemory(cpu, 0, access) ? 0 : access;
+
+        case code::Absolute:
+        case code::AbsoluteIndirect:
+            return isMemory(cpu, address, access) ? 0 : access;
+
+        case code::IndexedAbsoluteX:
+        case code::IndexedAbsoluteY:
+            // Indexed at most to the next page
+            return isMemory(cpu, address, access) &&
+                   isMemory(cpu, address + 0xff, access) ? 0 : access;
+
+        default:
+            // Indirect addresses are known when running only
+            return access;
+    }
+}
+
+inline bool BlockCore::isMemory(tones::MicroProcessor &cpu, uint16_t address, uint8_t access)
+{
+    const Page_t &page = cpu._bus.page(address);
+
+    if ((access & static_cast<uint8_t>(Access::Read)) && !page.rbase)
+        return false;
+
+    if ((access & static_cast<uint8_t>(Access::Write)) && !page.wbase)
+        return false;
+
+    return true;
+}
+
+inline bool BlockCore::endsBlock(code::InstructionKind_t type)
+{
+    switch (type) {
+        case code::BCC: case code::BCS: case code::BEQ: case code::BMI:
+        case code::BNE: case code::BPL: case code::BVC: case code::BVS:
+        case code::JMP: case code::JSR: case code::RTS: case code::RTI:
+        case code::BRK:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+inline bool BlockCore::isWritableCode(tones::MicroProcessor &cpu, uint16_t address)
+{
+    const Page_t &page = cpu._bus.page(address);
+    if (!page.rbase || page.rbase != page.wbase || page.mask < PageMask ||
+        (page.watch & static_cast<uint8_t>(Access::Write)))
+        return false;
+
+    // Written through the pages known in advance, without a check
+    const uint8_t *host = page.rbase + (address & page.mask & ~PageMask);
+    const Page_t &stack = cpu._stackPage;
+    return host != cpu._zeroPage.wbase && (!stack.wbase || host != stack.wbase + (StackBase & stack.mask));
+}
+
+void BlockCore::watchCode(tones::MicroProcessor &cpu, uint16_t address)
+{
+    const Page_t &code = cpu._bus.page(address);
+    const uint8_t *host = code.wbase + (address & code.mask & ~PageMask);
+
+    for (int index = 0; index < PageCount; ++index) {
+        const Page_t &page = cpu._bus.page(index << PageShift);
+        if (!page.wbase)
+            continue;
+
+        // Any page mapped over the same host memory, mirrors included
+        const uint8_t *begin = page.wbase + ((index << PageShift) & page.mask);
+        const uint8_t *end = begin + std::min<int>(page.mask, PageMask) + 1;
+        if (begin < host + PageMask + 1 && host < end)
+            cpu._codePages[index] = 1;
+    }
+}
+
+inline bool BlockCore::writesMemory(const Description_t &description)
+{
+    switch (description.type) {
+        case code::STA: case code::STX: case code::STY:
+            return true;
+
+        case code::ASL: case code::LSR: case code::ROL: case code::ROR:
+        case code::INC: case code::DEC:
+            return description.mode != code::Accumulator;
+
+        default:
+            return false;
+    }
+}
+
+/* CycleCountedCore */
+
+/**
+ * @brief Instructions with the accesses of every cycle
+ *
+ * Same instructions as the decoder, plus the accesses the 6502
+ * does while it computes the addresses: the read of an indexed
+ * address before the carry into its high byte, and the write
+ * of the unmodified byte by the read-modify-write ones. Dummy
+ * as they are, they reach MMIO, like PPUSTATUS cleared by a
+ * read. The extra cycles of page crossing and of the branches
+ * taken are counted too
+ *
+ * Run by the cycle-counted policy, whatever the dispatch is.
+ * The accesses of an instruction still happen on its first
+ * tick, only their number and the ticks it lasts are exact
+ */
+class CycleCountedCore
+{
+
+public:
+
+    //! Serve an interrupt, or run one instruction fetched from the bus
+    static void run(tones::MicroProcessor &cpu);
+
+protected:
+
+    //! Fetch the operands, with the dummy reads of the indexed modes
+    static inline void fetch(tones::MicroProcessor &cpu, code::InstructionKind_t type,
+                             code::AddressingKind_t mode);
+
+    //! Add an index to a base address, reading it first when the carry comes late
+    static inline void index(tones::MicroProcessor &cpu, code::InstructionKind_t type,
+                             uint16_t base, uint8_t index);
+
+    //! Read, write back the byte unmodified, then write the result
+    static inline void modify(tones::MicroProcessor &cpu, void (*executor)(State_t &state));
+
+    //! Whether a branch is taken, by the flags before it runs
+    static inline bool isTaken(const State_t &state, code::InstructionKind_t type);
+
+    //! Whether an instruction writes its operand, and does not only read it
+    static inline bool isWrite(code::InstructionKind_t type);
+
+    //! Whether an instruction writes its operand without reading it
+    static inline bool isStore(code::InstructionKind_t type);
+};
+
+void CycleCountedCore::run(tones::MicroProcessor &cpu)
+{
+    State_t &state = cpu._state;
+    InstructionDecoder &decoder = cpu._decoder;
+
+    if ((state.nmi | state.irq) && cpu.serve())
+        return;
+
+    ++state.instructions;
+
+    state.AB = state.PC++;
+    cpu.read();
+    state.IR = state.DBB;
+
+    if (cpu._profiler)
+        cpu._profiler->record(state.IR);
+
+    decoder.decode();
+
+    // The cycles of the operation set count the tick it runs on
+    if (state.skip)
+        --state.skip;
+
+    const code::InstructionKind_t type = decoder._operation->type->kind;
+    const code::AddressingKind_t mode = decoder._operation->mode->kind;
+
+    fetch(cpu, type, mode);
+
+    switch (type) {
+        case code::BCC: case code::BCS: case code::BEQ: case code::BMI:
+        case code::BNE: case code::BPL: case code::BVC: case code::BVS:
+            if (isTaken(state, type)) {
+                uint16_t next = state.PC;
+                decoder.execute();
+                state.skip += (next ^ state.PC) & 0xff00 ? 2 : 1;
+            }
+            return;
+
+        default:
+            break;
+    }
+
+    if (mode != code::Accumulator) {
+        switch (type) {
+            case code::ASL: modify(cpu, &ALU::ASL); return;
+            case code::LSR: modify(cpu, &ALU::LSR); return;
+            case code::ROL: modify(cpu, &ALU::ROL); return;
+            case code::ROR: modify(cpu, &ALU::ROR); return;
+            case code::INC: modify(cpu, &ALU::INC); return;
+            case code::DEC: modify(cpu, &ALU::DEC); return;
+            default: break;
+        }
+    }
+
+    decoder.execute();
+}
+
+inline void CycleCountedCore::fetch(tones::MicroProcessor &cpu, code::InstructionKind_t type,
+                             code::AddressingKind_t mode)
+{
+    State_t &state = cpu._state;
+
+    switch (mode) {
+        case code::IndexedZeroPageX:
+        case code::IndexedZeroPageY:
+            // The base address is read while the index is added
+            cpu.fetchOne();
+            state.AB = state.DBB;
+            cpu.read(cpu._zeroPage);
+            state.AB = (uint8_t)(state.AB + (code::IndexedZeroPageX == mode ? state.X : state.Y));
+            break;
+
+        case code::IndexedAbsoluteX:
+        case code::IndexedAbsoluteY:
+            cpu.fetchTwo();
+            reg::mergeTwoBytes(state.AB, state.DBB, state.DL);
+            index(cpu, type, state.AB, code::IndexedAbsoluteX == mode ? state.X : state.Y);
+            break;
+
+        case code::IndexedIndirect:
+            // So is the pointer, before X is added
+            cpu.fetchOne();
+            state.AB = state.DBB;
+            cpu.read(cpu._zeroPage);
+
+            state.AB = (uint8_t)(state.AB + state.X);
+            cpu.read(cpu._zeroPage);
+            state.DL = state.DBB;
+
+            state.AB = (uint8_t)(state.AB + 1);
+            cpu.read(cpu._zeroPage);
+            reg::mergeTwoBytes(state.AB, state.DBB, state.DL);
+            break;
+
+        case code::IndirectIndexed:
+            cpu.fetchOne();
+            state.AB = state.DBB;
+            cpu.read(cpu._zeroPage);
+            state.DL = state.DBB;
+
+            state.AB = (uint8_t)(state.AB + 1);
+            cpu.read(cpu._zeroPage);
+            reg::mergeTwoBytes(state.AB, state.DBB, state.DL);
+            index(cpu, type, state.AB, state.Y);
+            break;
+
+        default:
+            cpu.fetch();
+            break;
+    }
+}
+
+inline void CycleCountedCore::index(tones::MicroProcessor &cpu, code::InstructionKind_t type,
+                             uint16_t base, uint8_t index)
+{
+    State_t &state = cpu._state;
+    const uint16_t address = base + index;
+    const bool crossed = (base ^ address) & 0xff00;
+
+    // The low byte is added first, and the address read once
+    // before the high byte is fixed, unless a read is sure it
+    // is right already
+    if (crossed || isWrite(type)) {
+        state.AB = (base & 0xff00) | (address & 0x00ff);
+        cpu.read();
+    }
+
+    // One more cycle to fix it, which the operation set counts
+    // for the read-modify-write instructions only
+    if (isStore(type) || (crossed && !isWrite(type)))
+        ++state.skip;
+
+    state.AB = address;
+}
+
+inline void CycleCountedCore::modify(tones::MicroProcessor &cpu, void (*executor)(State_t &state))
+{
+    State_t &state = cpu._state;
+
+    cpu.read();
+    cpu.write();
+
+    state.DL = state.A;
+    state.A = state.DBB;
+    executor(state);
+    state.DBB = state.A;
+    state.A = state.DL;
+    cpu.write();
+}
+
+inline bool CycleCountedCore::isTaken(const State_t &state, code::InstructionKind_t type)
+{
+    switch (type) {
+        case code::BCC: return !state.flags.C;
+        case code::BCS: return state.flags.C;
+        case code::BEQ: return !state.flags.Z;
+        case code::BNE: return state.flags.Z;
+        case code::BMI: return state.flags.N & 0x80;
+        case code::BPL: return !(state.flags.N & 0x80);
+        case code::BVS: return state.flags.V & 0x80;
+        case code::BVC: return !(state.flags.V & 0x80);
+        default:        return false;
+    }
+}
+
+inline bool CycleCountedCore::isStore(code::InstructionKind_t type)
+{
+    return code::STA == type || code::STX == type || code::STY == type;
+}
+
+inline bool CycleCountedCore::isWrite(code::InstructionKind_t type)
+{
+    switch (type) {
+        case code::STA: case code::STX: case code::STY:
+        case code::ASL: case code::LSR: case code::ROL: case code::ROR:
+        case code::INC: case code::DEC:
+            return true;
+
+        default:
+            return false;
+    }
 }
 
 } // namespace cpu
@@ -605,10 +1827,17 @@ void InstructionDecoder::TYA()
 /* MicroProcessor */
 
 MicroProcessor::MicroProcessor(Bus &bus)
-    : _skip(0)
+    : _state()
+    , _dispatch(cpu::Dispatch::Switch)
+    , _codePages()
+    , _profiler(nullptr)
+    , _idleMark(0)
+    , _idleEntry(0)
+    , _cacheGeneration(bus.generation())
     , _decoder(*this)
-    , _alu(*this)
     , _bus(bus)
+    , _zeroPage(bus.page(0))
+    , _stackPage(bus.page(cpu::StackBase))
 {
 }
 
@@ -616,130 +1845,330 @@ MicroProcessor::~MicroProcessor() {}
 
 void MicroProcessor::tick()
 {
-    if (_skip) {
-        --_skip;
+    run(1);
+}
+
+template <class Policy>
+uint16_t MicroProcessor::run(uint32_t cycles)
+{
+    uint64_t end = _state.cycles + cycles;
+
+    while (_state.cycles < end) {
+        // The rest of the ticks of the last instruction, all at once
+        if (_state.skip) {
+            uint16_t ticks = std::min<uint64_t>(_state.skip, end - _state.cycles);
+            _state.cycles += ticks;
+            _state.skip -= ticks;
+            continue;
+        }
+
+        ++_state.cycles;
+        if (Policy::CountsCycles)
+            cpu::CycleCountedCore::run(*this);
+        else
+            execute();
+    }
+
+    return _state.skip;
+}
+
+template uint16_t MicroProcessor::run<accuracy::Fast>(uint32_t cycles);
+template uint16_t MicroProcessor::run<accuracy::CycleCounted>(uint32_t cycles);
+
+inline void MicroProcessor::execute()
+{
+    if ((_state.nmi | _state.irq) && serve())
+        return;
+
+    // These fetch the op code out of their caches
+    if (_dispatch == cpu::Dispatch::Cached) {
+        cpu::FusedCore::runCached(*this);
+        return;
+    } else if (_dispatch == cpu::Dispatch::Block) {
+        cpu::BlockCore::run<false>(*this);
+        return;
+    } else if (_dispatch == cpu::Dispatch::Native) {
+        cpu::BlockCore::run<true>(*this);
         return;
     }
 
+    ++_state.instructions;
+
     // Fetch opration code
-    _reg_AB = _reg_PC++;
+    _state.AB = _state.PC++;
     read();
-    _reg_IR = _reg_DBB;
+    _state.IR = _state.DBB;
+
+    if (_profiler)
+        _profiler->record(_state.IR);
 
-    _decoder.decode();
+    switch (_dispatch) {
+        case cpu::Dispatch::Switch:
+            dispatch();
+            break;
 
-    // Fetch oprands
-    fetch();
+        case cpu::Dispatch::Fused:
+            cpu::FusedCore::Handlers[_state.IR](*this);
+            break;
 
-    _decoder.execute();
+        default:
+            _decoder.decode();
+
+            // Fetch oprands
+            fetch();
+
+            _decoder.execute();
+            break;
+    }
 }
 
+template <class Policy>
 void MicroProcessor::step()
 {
-    while (_skip) {
-        tick();
-    }
-
-    tick();
+    run<Policy>(_state.skip + 1);
 }
 
+template void MicroProcessor::step<accuracy::Fast>();
+template void MicroProcessor::step<accuracy::CycleCounted>();
+
 void MicroProcessor::reset()
 {
-    _skip = 0;
+    _state.skip = 0;
+    _state.nmi = 0;
 
-    _reg_A = 0;
-    _reg_X = 0;
-    _reg_Y = 0;
-    _reg_S = cpu::DefaultStack;
-    _reg_P = cpu::DefaultStatus;
+    _state.A = 0;
+    _state.X = 0;
+    _state.Y = 0;
+    _state.S = cpu::DefaultStack;
+    setStatus(cpu::DefaultStatus);
 
     // Load PC from reset vector
-    _reg_PC = cpu::VectorRST;
+    _state.PC = cpu::VectorRST;
     fetchTwo();
-    reg::mergeTwoBytes(_reg_PC, _reg_DBB, _reg_DL);
+    reg::mergeTwoBytes(_state.PC, _state.DBB, _state.DL);
+
+    // RAM may have been loaded with anything since
+    invalidate();
 }
 
-void MicroProcessor::MicroProcessor::irq()
+void MicroProcessor::setIrq(cpu::IrqSource source, bool level)
 {
-    if (!GET_BIT(_reg_P, cpu::StatusBit::I)) {
-        interrupt(cpu::VectorIRQ);
-        // TODO: Cycle time
-    }
+    SET_BIT(_state.irq, source, level);
 }
 
-void MicroProcessor::MicroProcessor::nmi()
+void MicroProcessor::setNmi(bool level)
 {
-    interrupt(cpu::VectorNMI);
-    // TODO: Cycle time
+    if (level && !_state.nmiLine)
+        _state.nmi = 1;
+
+    _state.nmiLine = level;
+}
+
+void MicroProcessor::nmi()
+{
+    setNmi(true);
+    setNmi(false);
+}
+
+bool MicroProcessor::pending() const
+{
+    return _state.nmi || (_state.irq && !GET_BIT(_state.P, cpu::StatusBit::I));
 }
 
 void MicroProcessor::wait(uint16_t ticks)
 {
-    _skip += ticks;
+    _state.skip += ticks;
+}
+
+const uint64_t &MicroProcessor::cycles() const
+{
+    return _state.cycles;
+}
+
+const uint64_t &MicroProcessor::instructions() const
+{
+    return _state.instructions;
+}
+
+void MicroProcessor::setDispatch(cpu::Dispatch dispatch)
+{
+    // The blocks of the native dispatch are not fused, translate them again
+    if (dispatch != _dispatch) {
+        for (auto &block : _blocks)
+            block.tag = nullptr;
+    }
+
+    _dispatch = dispatch;
+
+    if (dispatch == cpu::Dispatch::Cached && _cache.empty())
+        _cache.resize(cpu::InstructionCacheSize, { nullptr, nullptr, 0, { 0, 0 } });
+
+    bool blocks = dispatch == cpu::Dispatch::Block || dispatch == cpu::Dispatch::Native;
+    if (blocks && _blocks.empty())
+        _blocks.resize(cpu::InstructionCacheSize, { nullptr, {}, 0, false, false, 0, nullptr });
+
+    if (dispatch == cpu::Dispatch::Native && !_jit)
+        _jit.reset(new jit::Compiler());
+}
+
+void MicroProcessor::setProfiler(cpu::Profiler *profiler)
+{
+    _profiler = profiler;
+}
+
+void MicroProcessor::setHorizon(cpu::Horizon horizon)
+{
+    _horizon = horizon;
 }
 
 void MicroProcessor::jump(uint16_t addr)
 {
-    _reg_PC = addr;
+    _state.PC = addr;
 }
 
 void MicroProcessor::dump(Registers_t &registers) const
 {
-    registers.A = _reg_A;
-    registers.X = _reg_X;
-    registers.Y = _reg_Y;
-    registers.S = _reg_S;
-    registers.P = _reg_P;
-    registers.PC = _reg_PC;
+    registers.A = _state.A;
+    registers.X = _state.X;
+    registers.Y = _state.Y;
+    registers.S = _state.S;
+    registers.P = status();
+    registers.PC = _state.PC;
+}
+
+void MicroProcessor::save(cpu::State_t &state) const
+{
+    state = _state;
+}
+
+void MicroProcessor::restore(const cpu::State_t &state)
+{
+    _state = state;
 }
 
 void MicroProcessor::interrupt(uint16_t vector)
 {
     // Save register PC to the stack
-    reg::getMSB(_reg_PC, _reg_DBB);
+    reg::getMSB(_state.PC, _state.DBB);
     push();
-    reg::getLSB(_reg_PC, _reg_DBB);
+    reg::getLSB(_state.PC, _state.DBB);
     push();
 
     // Save register P to the stack
-    _reg_DBB = _reg_P;
+    _state.DBB = status();
     push();
 
-    SEL_BIT(_reg_P, cpu::StatusBit::I);
+    SEL_BIT(_state.P, cpu::StatusBit::I);
 
     // Load PC from break vector
-    _reg_PC = vector;
+    _state.PC = vector;
     fetchTwo();
-    reg::mergeTwoBytes(_reg_PC, _reg_DBB, _reg_DL);
+    reg::mergeTwoBytes(_state.PC, _state.DBB, _state.DL);
+
+    _state.skip += 7;
+}
+
+void MicroProcessor::invalidate()
+{
+    _codePages.fill(0);
+
+    // Their steps are still run, if the write is by one of them
+    for (auto &block : _blocks) {
+        if (block.writable) {
+            block.tag = nullptr;
+            block.writable = false;
+            block.native = nullptr;
+        }
+    }
+}
+
+inline bool MicroProcessor::serve()
+{
+    if (_state.nmi) {
+        _state.nmi = 0;
+        interrupt(cpu::VectorNMI);
+    } else if (!GET_BIT(_state.P, cpu::StatusBit::I)) {
+        interrupt(cpu::VectorIRQ);
+    } else {
+        return false;
+    }
+
+    // In place of an instruction, which runs on this tick
+    --_state.skip;
+    return true;
+}
+
+inline uint8_t MicroProcessor::status() const
+{
+    uint8_t status = _state.P;
+    SET_BIT(status, cpu::StatusBit::N, _state.flags.N & 0x80);
+    SET_BIT(status, cpu::StatusBit::V, _state.flags.V & 0x80);
+    SET_BIT(status, cpu::StatusBit::Z, !_state.flags.Z);
+    SET_BIT(status, cpu::StatusBit::C, _state.flags.C);
+    return status;
+}
 
-    _skip += 7;
+inline void MicroProcessor::setStatus(uint8_t status)
+{
+    _state.P = status;
+    _state.flags.N = status;
+    _state.flags.V = status << 1;
+    _state.flags.Z = !GET_BIT(status, cpu::StatusBit::Z);
+    _state.flags.C = GET_BIT(status, cpu::StatusBit::C);
 }
 
 inline void MicroProcessor::read()
 {
-    _bus.read(_reg_AB, _reg_DBB);
+    _bus.read(_state.AB, _state.DBB);
 }
 
 inline void MicroProcessor::write()
 {
-    _bus.write(_reg_AB, _reg_DBB);
+    _bus.write(_state.AB, _state.DBB);
+
+    if (_codePages[_state.AB >> PageShift])
+        invalidate();
 }
 
-inline void MicroProcessor::push()
+inline void MicroProcessor::read(const Page_t &page)
 {
-    _reg_AB = cpu::StackBase | _reg_S--;
+#ifndef TONES_BUS_TRACE
+    if (page.rbase) {
+        _state.DBB = page.rbase[_state.AB & page.mask];
+        return;
+    }
+#endif
+
+    read();
+}
+
+inline void MicroProcessor::write(const Page_t &page)
+{
+#ifndef TONES_BUS_TRACE
+    if (page.wbase) {
+        page.wbase[_state.AB & page.mask] = _state.DBB;
+        return;
+    }
+#endif
+
     write();
 }
 
+inline void MicroProcessor::push()
+{
+    _state.AB = cpu::StackBase | _state.S--;
+    write(_stackPage);
+}
+
 inline void MicroProcessor::pop()
 {
-    _reg_AB = cpu::StackBase | ++_reg_S;
-    read();
+    _state.AB = cpu::StackBase | ++_state.S;
+    read(_stackPage);
 }
 
 inline void MicroProcessor::branch()
 {
-    _reg_PC += (int8_t)_reg_DBB;
+    _state.PC += (int8_t)_state.DBB;
 }
 
 inline void MicroProcessor::fetch()
@@ -747,45 +2176,83 @@ inline void MicroProcessor::fetch()
     (this->*(_decoder._operation->mode->fetcher))();
 }
 
+/* Fetchers of the addressing modes, by the names in the operation set */
+#define FETCH_IMP fetchNull
+#define FETCH_ACC fetchNull
+#define FETCH_IMM fetchImmediate
+#define FETCH_ABS fetchAbsolute
+#define FETCH_ZP  fetchZeroPage
+#define FETCH_ZPX fetchIndexedZeroPageX
+#define FETCH_ZPY fetchIndexedZeroPageY
+#define FETCH_ABX fetchIndexedAbsoluteX
+#define FETCH_ABY fetchIndexedAbsoluteY
+#define FETCH_REL fetchRelative
+#define FETCH_IDX fetchIndexedIndirect
+#define FETCH_IDY fetchIndirectIndexed
+#define FETCH_IND fetchAbsoluteIndirect
+
+// Same steps as decode(), fetch() and execute(), with the
+// operation resolved by the case instead of the pointers
+#define DISPATCH_OPERATION(code, type, mode, cycles) \
+    case code:                                        \
+        _decoder._operation = cpu::OperationSet[code]; \
+        _state.skip = cycles;                                \
+        FETCH_##mode();                                \
+        _decoder.type();                               \
+        break;
+
+#define DISPATCH_UNKNOWN(code)                        \
+    case code:                                        \
+        _decoder._operation = &cpu::UnknownOperation; \
+        _state.skip = 0;                                    \
+        break;
+
+inline void MicroProcessor::dispatch()
+{
+    switch (_state.IR) {
+        TONES_OPERATION_SET(DISPATCH_OPERATION, DISPATCH_UNKNOWN)
+    }
+}
+
 void MicroProcessor::fetchNull() {
     /* No operand needed */
 }
 
 void MicroProcessor::fetchImmediate()
 {
-    _reg_AB = _reg_PC++;
+    _state.AB = _state.PC++;
 }
 
 void MicroProcessor::fetchAbsolute()
 {
     fetchTwo();
-    reg::mergeTwoBytes(_reg_AB, _reg_DBB, _reg_DL);
+    reg::mergeTwoBytes(_state.AB, _state.DBB, _state.DL);
 }
 
 void MicroProcessor::fetchZeroPage()
 {
     fetchOne();
-    _reg_AB = _reg_DBB;
+    _state.AB = _state.DBB;
 }
 
 void MicroProcessor::fetchIndexedZeroPageX()
 {
-    fetchIndexedZeroPage(_reg_X);
+    fetchIndexedZeroPage(_state.X);
 }
 
 void MicroProcessor::fetchIndexedZeroPageY()
 {
-    fetchIndexedZeroPage(_reg_Y);
+    fetchIndexedZeroPage(_state.Y);
 }
 
 void MicroProcessor::fetchIndexedAbsoluteX()
 {
-    fetchIndexedAbsolute(_reg_X);
+    fetchIndexedAbsolute(_state.X);
 }
 
 void MicroProcessor::fetchIndexedAbsoluteY()
 {
-    fetchIndexedAbsolute(_reg_Y);
+    fetchIndexedAbsolute(_state.Y);
 }
 
 void MicroProcessor::fetchRelative()
@@ -798,18 +2265,18 @@ void MicroProcessor::fetchIndexedIndirect()
     fetchOne();
 
     // Fetch ABL
-    _reg_AB = _reg_DBB + _reg_X;
-    _reg_AB &= 0xff;
-    read();
+    _state.AB = _state.DBB + _state.X;
+    _state.AB &= 0xff;
+    read(_zeroPage);
 
-    _reg_DL = _reg_DBB;
+    _state.DL = _state.DBB;
 
     // Fetch ABH
-    ++_reg_AB;
-    _reg_AB &= 0xff;
-    read();
+    ++_state.AB;
+    _state.AB &= 0xff;
+    read(_zeroPage);
 
-    reg::mergeTwoBytes(_reg_AB, _reg_DBB, _reg_DL);
+    reg::mergeTwoBytes(_state.AB, _state.DBB, _state.DL);
 }
 
 void MicroProcessor::fetchIndirectIndexed()
@@ -817,18 +2284,18 @@ void MicroProcessor::fetchIndirectIndexed()
     fetchOne();
 
     // Fetch ABL
-    _reg_AB = _reg_DBB;
-    read();
+    _state.AB = _state.DBB;
+    read(_zeroPage);
 
-    _reg_DL = _reg_DBB;
+    _state.DL = _state.DBB;
 
     // Fetch ABH
-    ++_reg_AB;
-    _reg_AB &= 0xff;
-    read();
+    ++_state.AB;
+    _state.AB &= 0xff;
+    read(_zeroPage);
 
-    reg::mergeTwoBytes(_reg_AB, _reg_DBB, _reg_DL);
-    _reg_AB += _reg_Y;
+    reg::mergeTwoBytes(_state.AB, _state.DBB, _state.DL);
+    _state.AB += _state.Y;
 }
 
 void MicroProcessor::fetchAbsoluteIndirect()
@@ -836,57 +2303,57 @@ void MicroProcessor::fetchAbsoluteIndirect()
     fetchTwo();
 
     // Fetch ABL
-    reg::mergeTwoBytes(_reg_AB, _reg_DBB, _reg_DL);
+    reg::mergeTwoBytes(_state.AB, _state.DBB, _state.DL);
     read();
 
-    _reg_DL = _reg_DBB;
+    _state.DL = _state.DBB;
 
     // Fetch ABH
     // 6502 CPU has a bug, that when an indirect address begins at
     // the last byte of one page, the second byte is fetched from
     // the first byte of the page, rather than the next byte.
-    // So, just '++_reg_AB' will not work here.
-    _reg_AB = (_reg_AB & 0xff00) | ((_reg_AB + 1) & 0xff);
+    // So, just '++_state.AB' will not work here.
+    _state.AB = (_state.AB & 0xff00) | ((_state.AB + 1) & 0xff);
     read();
 
-    reg::mergeTwoBytes(_reg_AB, _reg_DBB, _reg_DL);
+    reg::mergeTwoBytes(_state.AB, _state.DBB, _state.DL);
 }
 
 inline void MicroProcessor::popTwo()
 {
     pop();
-    _reg_DL = _reg_DBB;
+    _state.DL = _state.DBB;
     pop();
 };
 
 inline void MicroProcessor::fetchOne()
 {
-    _reg_AB = _reg_PC++;
+    _state.AB = _state.PC++;
     read();
 }
 
 inline void MicroProcessor::fetchTwo()
 {
-    _reg_AB = _reg_PC++;
+    _state.AB = _state.PC++;
     read();
 
-    _reg_DL = _reg_DBB;
+    _state.DL = _state.DBB;
 
-    _reg_AB = _reg_PC++;
+    _state.AB = _state.PC++;
     read();
 }
 
 inline void MicroProcessor::fetchIndexedZeroPage(uint8_t index)
 {
     fetchOne();
-    _reg_AB = (uint8_t)(_reg_DBB + index);
+    _state.AB = (uint8_t)(_state.DBB + index);
 }
 
 inline void MicroProcessor::fetchIndexedAbsolute(uint8_t index)
 {
     fetchTwo();
-    reg::mergeTwoBytes(_reg_AB, _reg_DBB, _reg_DL);
-    _reg_AB += index;
+    reg::mergeTwoBytes(_state.AB, _state.DBB, _state.DL);
+    _state.AB += index;
 }
 
 } // namespace tones
@@ -1,11 +1,14 @@
 
 #include "MotherBoard.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <thread>
 #include <memory>
 
 #include "Log.h"
+#include "System.h"
 
 namespace tones {
 
@@ -37,10 +40,19 @@ void DirectMemoryAccess::write(uint16_t, uint8_t data)
 {
     _page = data;
     _addr = (uint16_t)_page << 8;
-    for (int i = 0; i < _len; ++i) {
-        _bus->read(_addr, _buff);
-        _bus->write(_dest, _buff);
-        ++_addr;
+
+    // Copy the whole block at once from memory, while a
+    // page of MMIO, or one watched or traced, is still read
+    // byte by byte
+    const uint8_t *source = _bus->memory(_addr);
+    if (source && _len <= PageSize) {
+        _bus->transfer(_dest, source, _len);
+    } else {
+        for (int i = 0; i < _len; ++i) {
+            _bus->read(_addr, _buff);
+            _bus->write(_dest, _buff);
+            ++_addr;
+        }
     }
 
     if (_handler)
@@ -52,13 +64,78 @@ void DirectMemoryAccess::setHandler(std::function<void(void)> handler)
     _handler = handler;
 }
 
+/* CatchUp */
+
+CatchUp::CatchUp(MicroProcessor &cpu, PictureProcessingUnit &ppu, int ratio)
+    : _cpu(cpu)
+    , _ppu(ppu)
+    , _ratio(ratio)
+    , _synced(cpu.cycles())
+{
+}
+
+uint32_t CatchUp::ahead(uint32_t ticks)
+{
+    align();
+
+    // One tick at a time, right before anything happens
+    ticks = std::min(ticks, std::max<uint32_t>(_ppu.quietDots() / _ratio, 1));
+
+    _cpu.run(ticks);
+    align();
+    return ticks;
+}
+
+void CatchUp::run(uint32_t ticks)
+{
+    while (ticks > 0)
+        ticks -= ahead(ticks);
+}
+
+void CatchUp::sync()
+{
+    // Its accesses are on the first tick of an instruction, so
+    // the PPU is at the end of the one before
+    advance(_cpu.cycles() - 1);
+}
+
+void CatchUp::align()
+{
+    advance(_cpu.cycles());
+}
+
+uint32_t CatchUp::quietTicks() const
+{
+    uint64_t lag = (_cpu.cycles() - _synced) * _ratio;
+    uint32_t quiet = _ppu.quietDots();
+
+    return quiet > lag ? (quiet - lag) / _ratio : 0;
+}
+
+void CatchUp::reset()
+{
+    _synced = _cpu.cycles();
+}
+
+inline void CatchUp::advance(uint64_t tick)
+{
+    if (tick > _synced) {
+        _ppu.run((uint32_t)(tick - _synced) * _ratio);
+        _synced = tick;
+    }
+}
+
 /* MotherBoard */
 
-MotherBoard::MotherBoard() 
+MotherBoard::MotherBoard(cpu::Dispatch dispatch)
     : _frequency(29781) // TODO: frequency depending on video type
     , _cpu(_mbus)
     , _ppu(_vbus, _mbus)
+    , _catchUp(_cpu, _ppu, board::NROM::PpuTicks / board::NROM::CpuTicks)
     , _odma(OAMDMA, ppu::OAMDATA, ppu::SpriteMemorySize)
+#ifdef TONES_BUS_TRACE
+    , _traceWriter(_tracer)
+#endif
     , _started(false)
     , _paused(true)
     , _output(&DefaultOuput)
@@ -72,10 +149,21 @@ MotherBoard::MotherBoard()
         _cpu.wait(513);
     });
 
-    _cpu.attach(_clock, 1);
-    _ppu.attach(_clock, 3);
+    _cpu.setDispatch(dispatch);
 
     _ppu.setBlankHandler([&] () { _cpu.nmi(); });
+    _ppu.setSync([this] () { _catchUp.sync(); });
+
+    // Nothing but the PPU changes what the CPU reads, or interrupts it
+    _cpu.setHorizon([this] () { return _catchUp.quietTicks(); });
+
+    _mbus.setWatcher([this] (uint16_t address, uint8_t data, Access access) {
+        _output->onCpuWatchpoint(address, data, access);
+    });
+
+    _vbus.setWatcher([this] (uint16_t address, uint8_t data, Access access) {
+        _output->onPpuWatchpoint(address, data, access);
+    });
 }
 
 void MotherBoard::insert(CartridgePtr &card)
@@ -83,6 +171,7 @@ void MotherBoard::insert(CartridgePtr &card)
     eject();
     _card = card;
     _card->attach(_mbus, _vbus);
+    _vram.setMirroring(_card->mirroring());
     reset();
 }
 
@@ -153,6 +242,7 @@ void MotherBoard::reset()
 {
     _cpu.reset();
     _ppu.reset();
+    _catchUp.reset();
 
     _output->onRegistersChanged();
 }
@@ -172,11 +262,9 @@ void MotherBoard::run()
     while (_started) { // loop on video frame
         auto start = system_clock::now();
 
-        for (uint32_t i = 0; i < _frequency; ++i) {
-            if (_paused)
-                break;
-            _clock.tick();
-        }
+        // The CPU runs ahead of the PPU, as long as it is quiet
+        for (uint32_t i = 0; i < _frequency && !_paused; )
+            i += _catchUp.ahead(_frequency - i);
 
         auto duration = duration_cast<microseconds>(system_clock::now() - start);
         std::this_thread::sleep_for(cycle - duration);
@@ -200,15 +288,16 @@ void MotherBoard::dumpPpuPalettes(std::array<uint8_t, ppu::Palettes::PalettesSiz
 
 void MotherBoard::dumpCpuMemory(std::array<uint8_t, AddressSpace> &memory)
 {
-    for (int addr = 0; addr < AddressSpace; ++addr) {
-        _mbus.read(addr, memory[addr]);
-    }
+    _mbus.dump(0, memory.data(), AddressSpace);
 }
 
 void MotherBoard::dumpPpuMemory(std::array<uint8_t, AddressSpace> &memory)
 {
-    for (int addr = 0; addr < AddressSpace; ++addr) {
-        _vbus.read(addr & ppu::VBusAddressMask, memory[addr]);
+    const int size = ppu::VBusAddressMask + 1;
+
+    _vbus.dump(0, memory.data(), size);
+    for (int addr = size; addr < AddressSpace; addr += size) {
+        memcpy(memory.data() + addr, memory.data(), size);
     }
 }
 
@@ -217,4 +306,62 @@ void MotherBoard::dumpPpuOam(std::array<uint8_t, ppu::SpriteMemorySize> &oam)
     _ppu.dumpPpuOam(oam);
 }
 
+void MotherBoard::watchCpuMemory(uint16_t address, Access access)
+{
+    _mbus.watch(address, access);
+}
+
+void MotherBoard::unwatchCpuMemory(uint16_t address, Access access)
+{
+    _mbus.unwatch(address, access);
+}
+
+void MotherBoard::watchPpuMemory(uint16_t address, Access access)
+{
+    _vbus.watch(address & ppu::VBusAddressMask, access);
+}
+
+void MotherBoard::unwatchPpuMemory(uint16_t address, Access access)
+{
+    _vbus.unwatch(address & ppu::VBusAddressMask, access);
+}
+
+bool MotherBoard::addCheat(const std::string &code)
+{
+    Cheat_t patch;
+    if (!_card || !cheat::decode(code, patch)) {
+        LOG_ERROR() << "Invalid cheat " << code;
+        return false;
+    }
+
+    _card->patch(patch);
+    return true;
+}
+
+void MotherBoard::clearCheats()
+{
+    if (_card)
+        _card->unpatch();
+}
+
+#ifdef TONES_BUS_TRACE
+bool MotherBoard::startTrace(const std::string &path)
+{
+    if (!_traceWriter.open(path))
+        return false;
+
+    _tracer.setClock(&_cpu.cycles());
+    _mbus.setTracer(&_tracer, trace::CpuBus);
+    _vbus.setTracer(&_tracer, trace::PpuBus);
+    return true;
+}
+
+void MotherBoard::stopTrace()
+{
+    _mbus.setTracer(nullptr, trace::CpuBus);
+    _vbus.setTracer(nullptr, trace::PpuBus);
+    _traceWriter.close();
+}
+#endif
+
 } // namespace tones
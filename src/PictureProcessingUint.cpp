@@ -1,4 +1,5 @@
 
+#include <algorithm>
 #include <cstring>
 
 #include "PictureProcessingUnit.h"
@@ -34,6 +35,8 @@ bool MemoryMap::contains(uint16_t addr) const
 
 void MemoryMap::read(uint16_t address, uint8_t &buffer) const
 {
+    _ppu.sync();
+
     switch (address) {
         case ppu::PPUSTATUS: _ppu.readPPUSTATUS(); break;
         case ppu::OAMDATA:   _ppu.readOAMDATA();   break;
@@ -45,6 +48,7 @@ void MemoryMap::read(uint16_t address, uint8_t &buffer) const
 
 void MemoryMap::write(uint16_t address, uint8_t data)
 {
+    _ppu.sync();
     _ppu._reg_DBB = data;
 
     switch (address) {
@@ -58,6 +62,32 @@ void MemoryMap::write(uint16_t address, uint8_t data)
     }
 }
 
+void MemoryMap::peek(uint16_t address, uint8_t &buffer) const
+{
+    switch (address) {
+        case ppu::PPUSTATUS: buffer = _ppu._reg_STATUS;             break;
+        case ppu::OAMDATA:   buffer = _ppu._OAM[_ppu._reg_OAMADDR]; break;
+        case ppu::PPUDATA:   buffer = _ppu._reg_IRB;                break;
+        default:             buffer = _ppu._reg_DBB;                break;
+    }
+}
+
+bool MemoryMap::stable(uint16_t address) const
+{
+    // Reading them moves the addresses
+    return ppu::OAMDATA != address && ppu::PPUDATA != address;
+}
+
+void MemoryMap::transfer(uint16_t address, const uint8_t *data, int length)
+{
+    if (ppu::OAMDATA == address && length > 0) {
+        _ppu.sync();
+        _ppu.writeOAMDATA(data, length);
+    } else {
+        Accessible::transfer(address, data, length);
+    }
+}
+
 /* Palettes */
 
 Palettes::Palettes() {}
@@ -77,6 +107,13 @@ void Palettes::write(uint16_t address, uint8_t data)
     _memory[address & PalettesMask] = data;
 }
 
+void Palettes::map(uint16_t, Page_t &page)
+{
+    page.rbase = _memory.data();
+    page.wbase = _memory.data();
+    page.mask  = PalettesMask;
+}
+
 void Palettes::dump(std::array <uint8_t, PalettesSize> &colors) const
 {
     std::copy(_memory.begin(), _memory.end(), colors.begin());
@@ -114,6 +151,25 @@ void PictureProcessingUnit::tick()
     forward();
 }
 
+template <class Policy>
+void PictureProcessingUnit::run(uint32_t dots)
+{
+    while (dots) {
+        uint32_t idle = Policy::CountsCycles ? 0 : std::min(idleDots(), dots);
+        if (idle) {
+            pass(idle);
+            dots -= idle;
+            continue;
+        }
+
+        PictureProcessingUnit::tick();
+        --dots;
+    }
+}
+
+template void PictureProcessingUnit::run<accuracy::Fast>(uint32_t dots);
+template void PictureProcessingUnit::run<accuracy::CycleCounted>(uint32_t dots);
+
 void PictureProcessingUnit::reset()
 {
     _reg_CTRL    = 0x00;
@@ -144,6 +200,29 @@ void PictureProcessingUnit::setFrameEnd(FrameEnd flush)
     _flush = flush;
 }
 
+void PictureProcessingUnit::setSync(Sync sync)
+{
+    _sync = sync;
+}
+
+uint32_t PictureProcessingUnit::quietDots() const
+{
+    const int dots = _format.dotEnd + 1;
+    const int total = (_format.lineEnd + 1) * dots;
+    const int now = _reg_line.value * dots + _reg_dot.value;
+
+    // Status is set at the start of vblank, with NMI, and
+    // cleared at the pre-render scanline
+    int quiet = total;
+    for (int line : { _format.lineVBlank, _format.linePre }) {
+        int event = line * dots + _format.dotRender;
+        quiet = std::min(quiet, (event - now + total) % total);
+    }
+
+    // One dot may be skipped in odd frames
+    return quiet ? quiet - 1 : 0;
+}
+
 void PictureProcessingUnit::dump(Registers_t &registers) const
 {
     registers.T = _reg_T;
@@ -208,6 +287,20 @@ void PictureProcessingUnit::writeOAMDATA()
     ++_reg_OAMADDR;
 }
 
+void PictureProcessingUnit::writeOAMDATA(const uint8_t *data, int length)
+{
+    // OAMADDR wraps around, as it does for every single write
+    while (length > 0) {
+        int count = std::min(length, ppu::SpriteMemorySize - _reg_OAMADDR);
+        memcpy(_OAM + _reg_OAMADDR, data, count);
+        _reg_OAMADDR += count;
+        data += count;
+        length -= count;
+    }
+
+    _reg_DBB = data[-1];
+}
+
 /**
  * Registers T and V are composed this way during rendering
  * 
@@ -265,6 +358,34 @@ void PictureProcessingUnit::forward()
     ++_reg_dot;    
 }
 
+inline uint32_t PictureProcessingUnit::idleDots()
+{
+    const uint32_t rest = _format.dotEnd + 1 - _reg_dot.value;
+
+    // Same cases as tick()
+    if (_reg_line < _format.linePost || _reg_line == _format.linePre)
+        return showBackground() || showSprites() ? 0 : rest;
+
+    if (_reg_line == _format.lineVBlank) {
+        if (_reg_dot < _format.dotRender)
+            return _format.dotRender - _reg_dot.value;
+
+        return _reg_dot == _format.dotRender ? 0 : rest;
+    }
+
+    return rest;
+}
+
+inline void PictureProcessingUnit::pass(uint32_t dots)
+{
+    // All but the last one, which may start the next scanline
+    if (_reg_line.full())
+        _reg_frame = (_reg_frame.value + dots - 1) % (_reg_frame.limit + 1);
+
+    _reg_dot = _reg_dot.value + dots - 1;
+    forward();
+}
+
 void PictureProcessingUnit::linePre()
 {
     if (!showBackground() && !showSprites())
@@ -408,7 +529,7 @@ void PictureProcessingUnit::fetchBackground()
 
     switch (_reg_dot & ppu::TileMask) {
         case 2: // name table byte
-            _reg_AB = _reg_V & 0xfff | ppu::VBusAddressMask;
+            _reg_AB = ppu::NameTableBase | (_reg_V & 0x0fff);
             read();
             _reg_NTB = _reg_DBB;
             break;
@@ -517,6 +638,12 @@ inline void PictureProcessingUnit::write()
     _vbus.write(_reg_AB & ppu::VBusAddressMask, _reg_DBB);
 }
 
+inline void PictureProcessingUnit::sync()
+{
+    if (_sync)
+        _sync();
+}
+
 inline void PictureProcessingUnit::next()
 {
     _reg_V += GET_BIT(_reg_CTRL, ppu::ControllerBit::I) ? 0x20 : 0x01;
@@ -0,0 +1,71 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+
+#include "Instruction.h"
+
+namespace tones {
+namespace cpu {
+
+Profiler::Profiler()
+    : _pairs(OperationSetSize * OperationSetSize, 0)
+    , _total(0)
+    , _last(-1)
+{
+}
+
+void Profiler::restart()
+{
+    _last = -1;
+}
+
+void Profiler::clear()
+{
+    std::fill(_pairs.begin(), _pairs.end(), 0);
+    _total = 0;
+    _last = -1;
+}
+
+uint64_t Profiler::total() const
+{
+    return _total;
+}
+
+uint64_t Profiler::count(uint8_t first, uint8_t second) const
+{
+    return _pairs[first << 8 | second];
+}
+
+std::vector<Profiler::Pair_t> Profiler::hottest(int count) const
+{
+    std::vector<Pair_t> pairs;
+    for (int i = 0; i < (int)_pairs.size(); ++i) {
+        if (_pairs[i])
+            pairs.push_back({ (uint8_t)(i >> 8), (uint8_t)(i & 0xff), _pairs[i] });
+    }
+
+    count = std::min(count, (int)pairs.size());
+    std::partial_sort(pairs.begin(), pairs.begin() + count, pairs.end(),
+        [] (const Pair_t &a, const Pair_t &b) { return a.count > b.count; });
+    pairs.resize(count);
+
+    return pairs;
+}
+
+void Profiler::report(std::ostream &out, int count) const
+{
+    for (const Pair_t &pair : hottest(count)) {
+        const Operation_t *first = OperationSet[pair.first];
+        const Operation_t *second = OperationSet[pair.second];
+
+        out << first->type->name << " " << std::setw(3) << std::left << first->mode->name << " -> "
+            << second->type->name << " " << std::setw(3) << std::left << second->mode->name << " "
+            << std::setw(12) << std::right << pair.count << " "
+            << std::fixed << std::setprecision(2) << std::setw(6)
+            << (100.0 * pair.count / (_total ? _total : 1)) << "%" << std::endl;
+    }
+}
+
+} // namespace cpu
+} // namespace tones
@@ -0,0 +1,122 @@
+
+#include "Trace.h"
+
+#include <chrono>
+
+#include "Log.h"
+
+namespace tones {
+namespace trace {
+
+const int DrainBatch = 1024; // records
+
+/* RingBuffer */
+
+static uint32_t roundUp(int capacity)
+{
+    uint32_t size = 1;
+    while (size < (uint32_t)capacity)
+        size <<= 1;
+
+    return size;
+}
+
+RingBuffer::RingBuffer(int capacity)
+    : _records(roundUp(capacity))
+    , _mask(_records.size() - 1)
+    , _cycles(nullptr)
+    , _head(0)
+    , _dropped(0)
+    , _tail(0)
+{
+}
+
+void RingBuffer::setClock(const uint64_t *cycles)
+{
+    _cycles = cycles;
+}
+
+int RingBuffer::drain(Record_t *records, int count)
+{
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    uint32_t head = _head.load(std::memory_order_acquire);
+
+    int n = 0;
+    for (; n < count && tail != head; ++n, ++tail)
+        records[n] = _records[tail & _mask];
+
+    _tail.store(tail, std::memory_order_release);
+    return n;
+}
+
+uint64_t RingBuffer::dropped() const
+{
+    return _dropped;
+}
+
+/* Writer */
+
+Writer::Writer(RingBuffer &buffer)
+    : _buffer(buffer)
+    , _file(nullptr)
+    , _running(false)
+{
+}
+
+Writer::~Writer()
+{
+    close();
+}
+
+bool Writer::open(const std::string &path)
+{
+    close();
+
+    _file = std::fopen(path.c_str(), "wb");
+    if (!_file) {
+        LOG_ERROR() << "Cannot open trace file " << path;
+        return false;
+    }
+
+    _running = true;
+    _thread = std::thread(&Writer::run, this);
+    return true;
+}
+
+void Writer::close()
+{
+    if (!_file)
+        return;
+
+    _running = false;
+    _thread.join();
+
+    flush();
+    std::fclose(_file);
+    _file = nullptr;
+}
+
+bool Writer::isOpen() const
+{
+    return _file != nullptr;
+}
+
+void Writer::run()
+{
+    while (_running) {
+        flush();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void Writer::flush()
+{
+    Record_t records[DrainBatch];
+
+    int count;
+    while ((count = _buffer.drain(records, DrainBatch)) > 0)
+        std::fwrite(records, sizeof(Record_t), count, _file);
+}
+
+} // namespace trace
+} // namespace tones
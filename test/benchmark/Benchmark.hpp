@@ -0,0 +1,66 @@
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+
+/**
+ * @brief Measure the throughput of a piece of code
+ *
+ * The routine is run once to warm up, then repeatedly for
+ * the given rounds, and each round is expected to do the
+ * given number of operations
+ */
+class Benchmark
+{
+public:
+
+    Benchmark(const std::string &name, uint64_t operations, int rounds = 10)
+        : _name(name)
+        , _operations(operations)
+        , _rounds(rounds)
+        , _seconds(0) {}
+
+    double run(const std::function<void(void)> &routine)
+    {
+        using namespace std::chrono;
+
+        routine();
+
+        auto start = steady_clock::now();
+        for (int i = 0; i < _rounds; ++i)
+            routine();
+        _seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+        report();
+        return rate();
+    }
+
+    //! Operations per second
+    double rate() const
+    {
+        return _seconds ? _operations * _rounds / _seconds : 0;
+    }
+
+    //! Nanoseconds per operation
+    double latency() const
+    {
+        return _operations ? _seconds * 1e9 / _operations / _rounds : 0;
+    }
+
+    void report() const
+    {
+        printf("%-32s %12.3f M/s %10.3f ns\n", _name.c_str(), rate() / 1e6, latency());
+    }
+
+private:
+
+    std::string _name;
+
+    uint64_t _operations;
+
+    int _rounds;
+
+    double _seconds;
+};
@@ -0,0 +1,60 @@
+
+#include "Device.h"
+
+#include "Benchmark.hpp"
+
+using namespace tones;
+
+const int Accesses = 1 << 20;
+
+static uint8_t sink;
+
+void access(Bus &bus, uint16_t base)
+{
+    uint8_t buffer = 0;
+    for (int i = 0; i < Accesses; ++i) {
+        uint16_t addr = base | (i & PageMask);
+        bus.write(addr, buffer + i);
+        bus.read(addr, buffer);
+    }
+    sink = buffer;
+}
+
+int main()
+{
+    Bus bus;
+    RandomAccessMemory ram;
+
+    ram.attach(bus);
+
+    Benchmark("RAM Access", Accesses * 2).run([&] () {
+        access(bus, 0x0000);
+    });
+
+#ifdef TONES_BUS_TRACE
+    trace::RingBuffer tracer;
+    trace::Record_t records[1024];
+    bus.setTracer(&tracer, trace::CpuBus);
+
+    Benchmark("RAM Access, Traced", Accesses * 2).run([&] () {
+        access(bus, 0x0000);
+        while (tracer.drain(records, 1024)) {}
+    });
+
+    bus.setTracer(nullptr, trace::CpuBus);
+#endif
+
+    bus.setWatcher([] (uint16_t, uint8_t, Access) {});
+    bus.watch(0x0100, Access::Read);
+    bus.watch(0x0100, Access::Write);
+
+    Benchmark("RAM Access, Unwatched Page", Accesses * 2).run([&] () {
+        access(bus, 0x0000);
+    });
+
+    Benchmark("RAM Access, Watched Page", Accesses * 2).run([&] () {
+        access(bus, 0x0100);
+    });
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <iostream>
+
+#include "Device.h"
+#include "Cartridge.h"
+#include "MicroProcessor.h"
+#include "Batch.h"
+
+#include "roms.h"
+#include "Benchmark.hpp"
+
+using namespace tones;
+
+const int NesTestEntry = 0xc000;
+const int NesTestSteps = 5000; // unofficial instructions after 5004
+const int Repeats = 100;
+
+int main()
+{
+    Bus mbus, vbus;
+    RandomAccessMemory pram;
+    MicroProcessor cpu(mbus);
+
+    auto card = CartridgeFactory::createCartridge(getRomBin("nestest"));
+    if (!card)
+        return 1;
+
+    pram.attach(mbus);
+    card->attach(mbus, vbus);
+
+    auto nestest = [&] () {
+        for (int r = 0; r < Repeats; ++r) {
+            cpu.reset();
+            cpu.jump(NesTestEntry);
+
+            // A step may run a block of instructions
+            uint64_t end = cpu.instructions() + NesTestSteps;
+            while (cpu.instructions() < end)
+                cpu.step();
+        }
+    };
+
+    cpu.setDispatch(cpu::Dispatch::Table);
+    Benchmark("NesTest Instructions, Table", NesTestSteps * Repeats).run(nestest);
+
+    cpu.setDispatch(cpu::Dispatch::Switch);
+    Benchmark("NesTest Instructions, Switch", NesTestSteps * Repeats).run(nestest);
+
+    cpu.setDispatch(cpu::Dispatch::Fused);
+    Benchmark("NesTest Instructions, Fused", NesTestSteps * Repeats).run(nestest);
+
+    cpu.setDispatch(cpu::Dispatch::Cached);
+    Benchmark("NesTest Instructions, Cached", NesTestSteps * Repeats).run(nestest);
+
+    cpu.setDispatch(cpu::Dispatch::Block);
+    Benchmark("NesTest Instructions, Block", NesTestSteps * Repeats).run(nestest);
+
+    cpu.setDispatch(cpu::Dispatch::Native);
+    Benchmark("NesTest Instructions, Native", NesTestSteps * Repeats).run(nestest);
+
+    cpu.setDispatch(cpu::Dispatch::Switch);
+    Benchmark("NesTest Instructions, CycleCounted", NesTestSteps * Repeats).run([&] () {
+        for (int r = 0; r < Repeats; ++r) {
+            cpu.reset();
+            cpu.jump(NesTestEntry);
+
+            uint64_t end = cpu.instructions() + NesTestSteps;
+            while (cpu.instructions() < end)
+                cpu.step<accuracy::CycleCounted>();
+        }
+    });
+
+    // One call a tick, or one call a budget of ticks
+    const uint32_t NesTestTicks = 15000;
+
+    auto ticks = [&] (uint32_t budget) {
+        for (int r = 0; r < Repeats; ++r) {
+            cpu.reset();
+            cpu.jump(NesTestEntry);
+
+            for (uint32_t t = 0; t < NesTestTicks; t += budget)
+                cpu.run(budget);
+        }
+    };
+
+    cpu.setDispatch(cpu::Dispatch::Switch);
+    Benchmark("NesTest Ticks, tick()", NesTestTicks * Repeats).run([&] () {
+        for (int r = 0; r < Repeats; ++r) {
+            cpu.reset();
+            cpu.jump(NesTestEntry);
+
+            for (uint32_t t = 0; t < NesTestTicks; ++t)
+                cpu.tick();
+        }
+    });
+    Benchmark("NesTest Ticks, run(114)", NesTestTicks * Repeats).run([&] () { ticks(114); });
+
+    // Instances side by side, all at the same PC but where they differ
+    const int BatchLanes = 64;
+    cpu::Batch batch(BatchLanes);
+    if (!batch.insert(getRomBin("nestest")))
+        return 1;
+
+    Benchmark("NesTest Instructions, Batch of 64", NesTestSteps * BatchLanes).run([&] () {
+        batch.reset();
+        batch.jump(NesTestEntry);
+        batch.run(NesTestSteps);
+    });
+    batch.report(std::cout);
+
+    // Candidates of superinstructions
+    cpu::Profiler profiler;
+    cpu.setDispatch(cpu::Dispatch::Switch);
+    cpu.setProfiler(&profiler);
+    nestest();
+    cpu.setProfiler(nullptr);
+
+    std::cout << std::endl << "Hottest op code pairs:" << std::endl;
+    profiler.report(std::cout, 8);
+
+    return 0;
+}
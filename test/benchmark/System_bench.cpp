@@ -0,0 +1,66 @@
+
+#include "Clock.h"
+#include "System.h"
+
+#include "roms.h"
+#include "Benchmark.hpp"
+
+using namespace tones;
+
+const int Frames = 60;
+
+int main()
+{
+    auto card = CartridgeFactory::createCartridge(getRomBin("nestest"));
+    if (!card)
+        return 1;
+
+    {
+        // Wired as MotherBoard
+        Bus mbus, vbus;
+        Clock clock;
+        MicroProcessor cpu(mbus);
+        PictureProcessingUnit ppu(vbus, mbus);
+        RandomAccessMemory pram;
+        VideoRandomAccessMemory vram;
+
+        pram.attach(mbus);
+        vram.attach(vbus);
+        card->attach(mbus, vbus);
+        cpu.attach(clock, board::NROM::CpuTicks);
+        ppu.attach(clock, board::NROM::PpuTicks);
+        ppu.setBlankHandler([&] () { cpu.nmi(); });
+        cpu.reset();
+        ppu.reset();
+
+        Benchmark("Clock Ticks", Frames * board::NROM::Frequency).run([&] () {
+            for (int f = 0; f < Frames; ++f) {
+                for (uint32_t i = 0; i < board::NROM::Frequency; ++i)
+                    clock.tick();
+            }
+        });
+
+        card->detach();
+    }
+
+    {
+        NromSystem system;
+        system.insert(card);
+
+        Benchmark("NromSystem Ticks", Frames * board::NROM::Frequency).run([&] () {
+            for (int f = 0; f < Frames; ++f)
+                system.frame();
+        });
+    }
+
+    // The cycle-counted variants of the CPU and the PPU
+    CycleCountedNromSystem counted;
+    counted.insert(card);
+
+    Benchmark("CycleCountedNromSystem Ticks", Frames * board::NROM::Frequency).run([&] () {
+        for (int f = 0; f < Frames; ++f)
+            counted.frame();
+    });
+
+    return 0;
+}
@@ -0,0 +1,35 @@
+.segment "NES_FILE_HEADER"
+.byte "NES", $1A, 2
+
+.segment "CODE"
+main:
+    LDX $10     ; input of the instance
+    LDA #$0
+
+count:
+    CLC
+    ADC #$3
+    DEX
+    BNE count   ; as many times as the input
+
+    STA $0200
+    INC $0201
+    LDY $0201
+    CPY #$4
+    BCC main    ; a few times in all
+
+done:
+    JSR call
+    INC $0202
+    JMP done
+
+call:
+    LDA $0202
+    EOR #$ff
+    SEC
+    SBC $10
+    STA $0203
+    RTS
+
+.segment "INTERRUPT_VECTOR"
+    .word main, main, main
@@ -0,0 +1,27 @@
+.segment "NES_FILE_HEADER"
+.byte "NES", $1A, 2
+
+.segment "CODE"
+main:
+    LDX #$10
+copy:
+    LDA $8000,X ; LDA ABS, X / STA ABS, X
+    STA $0200,X
+    DEX         ; DEX / BNE
+    BNE copy
+
+    LDY #$0
+count:
+    INY         ; INY / CPY # / BNE
+    CPY #$08
+    BNE count
+
+    LDA $10     ; LDA ZP / STA ABS
+    STA $0300
+
+wait:
+    BIT $2002   ; BIT ABS / BPL
+    BPL wait
+
+.segment "INTERRUPT_VECTOR"
+    .word main, main, main
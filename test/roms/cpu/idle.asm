@@ -0,0 +1,18 @@
+.segment "NES_FILE_HEADER"
+.byte "NES", $1A, 2
+
+.segment "CODE"
+main:
+    LDA #$0
+    STA $10
+
+wait:
+    LDA $10     ; polls a flag set by an interrupt
+    BEQ wait
+
+done:
+    INX
+    JMP done
+
+.segment "INTERRUPT_VECTOR"
+    .word main, main, main
@@ -0,0 +1,116 @@
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "Batch.h"
+#include "Device.h"
+
+#include "roms.h"
+#include "RomParser.hpp"
+
+using namespace tones;
+
+const int BatchLanes = 16;
+const int BatchRounds = 2000;
+const uint16_t BatchInput = 0x0010;
+const uint16_t BatchOutput = 0x0200; // to $0203
+
+/**
+ * @brief One instance of the program alone, on the switch core
+ */
+struct Reference {
+    Reference(const std::string &path, uint8_t input)
+        : cpu(mbus)
+    {
+        pram.attach(mbus);
+        card = CartridgeFactory::createCartridge(path);
+        card->attach(mbus, vbus);
+
+        for (int address = 0; address < RandomAccessMemory::RamSize; ++address)
+            mbus.write(address, 0);
+        mbus.write(BatchInput, input);
+
+        cpu.reset();
+        origin = cpu.cycles();
+    }
+
+    uint64_t ticks() const
+    {
+        cpu::State_t state;
+        cpu.save(state);
+        return state.cycles + state.skip - origin;
+    }
+
+    Bus mbus, vbus;
+    RandomAccessMemory pram;
+    MicroProcessor cpu;
+    CartridgePtr card;
+    uint64_t origin;
+};
+
+static uint8_t inputOf(int lane)
+{
+    // A few lanes with the same input, to run in groups the longest
+    return 1 + lane % 5 * 23;
+}
+
+TEST(BatchTest, SameAsScalar)
+{
+    const std::string path = getRomBin(ROM_BATCH);
+
+    cpu::Batch batch(BatchLanes);
+    ASSERT_TRUE(batch.insert(path));
+    for (int lane = 0; lane < BatchLanes; ++lane)
+        batch.write(lane, BatchInput, inputOf(lane));
+
+    batch.run(BatchRounds);
+
+    for (int lane = 0; lane < BatchLanes; ++lane) {
+        Reference reference(path, inputOf(lane));
+        for (int round = 0; round < BatchRounds; ++round)
+            reference.cpu.step();
+
+        MicroProcessor::Registers_t expected, actual;
+        reference.cpu.dump(expected);
+        batch.dump(lane, actual);
+
+        EXPECT_EQ(actual.PC, expected.PC) << "lane " << lane;
+        EXPECT_EQ(actual.A, expected.A) << "lane " << lane;
+        EXPECT_EQ(actual.X, expected.X) << "lane " << lane;
+        EXPECT_EQ(actual.Y, expected.Y) << "lane " << lane;
+        EXPECT_EQ(actual.S, expected.S) << "lane " << lane;
+        EXPECT_EQ(actual.P, expected.P) << "lane " << lane;
+        EXPECT_EQ(batch.ticks(lane), reference.ticks()) << "lane " << lane;
+
+        for (int address = BatchOutput; address < BatchOutput + 4; ++address) {
+            uint8_t data;
+            reference.mbus.peek(address, data);
+            EXPECT_EQ(batch.read(lane, address), data) << "lane " << lane << " at " << address;
+        }
+    }
+}
+
+TEST(BatchTest, Occupancy)
+{
+    cpu::Batch batch(BatchLanes);
+    ASSERT_TRUE(batch.insert(getRomBin(ROM_BATCH)));
+    for (int lane = 0; lane < BatchLanes; ++lane)
+        batch.write(lane, BatchInput, inputOf(lane));
+
+    batch.run(BatchRounds);
+
+    const cpu::Batch::Occupancy_t &occupancy = batch.occupancy();
+    EXPECT_EQ(occupancy.vectorLanes + occupancy.scalarSteps, (uint64_t)BatchLanes * BatchRounds);
+    EXPECT_GT(occupancy.vectorSteps, 0);
+    EXPECT_GT(occupancy.vectorLanes, occupancy.vectorSteps);
+
+    std::ostringstream report;
+    batch.report(report);
+    EXPECT_NE(report.str().find("in groups"), std::string::npos);
+}
+
+TEST(BatchTest, MissingFile)
+{
+    cpu::Batch batch(BatchLanes);
+    EXPECT_FALSE(batch.insert(getRomBin("nonexistent")));
+}
@@ -58,6 +58,60 @@ TEST_F(CartridgeTest, iNES)
 
     _mbus.read(cpu::VectorRST + 1, buffer);
     EXPECT_EQ(buffer, ReadOnlyMemory::RomLowerBankBase >> 8);
+
+    // Bit 0 and 3 of control byte 1 are cleared
+    EXPECT_EQ(card->mirroring(), Mirroring::Horizontal);
+}
+
+TEST_F(CartridgeTest, CheatCodes)
+{
+    Cheat_t cheat;
+
+    // Infinite lives of Super Mario Bros.
+    ASSERT_TRUE(cheat::decode("SXIOPO", cheat));
+    EXPECT_EQ(cheat.address, 0x91d9);
+    EXPECT_EQ(cheat.value, 0xad);
+    EXPECT_FALSE(cheat.compared);
+
+    ASSERT_TRUE(cheat::decode("sxiopoaa", cheat));
+    EXPECT_EQ(cheat.address, 0x91d9);
+    EXPECT_EQ(cheat.value, 0xa5);
+    EXPECT_EQ(cheat.compare, 0x08);
+    EXPECT_TRUE(cheat.compared);
+
+    ASSERT_TRUE(cheat::decode("C123:4f", cheat));
+    EXPECT_EQ(cheat.address, 0xc123);
+    EXPECT_EQ(cheat.value, 0x4f);
+    EXPECT_FALSE(cheat.compared);
+
+    ASSERT_TRUE(cheat::decode("C123?A9:4F", cheat));
+    EXPECT_EQ(cheat.compare, 0xa9);
+    EXPECT_TRUE(cheat.compared);
+
+    EXPECT_FALSE(cheat::decode("SXIOP", cheat));
+    EXPECT_FALSE(cheat::decode("SXIOPB", cheat));
+    EXPECT_FALSE(cheat::decode("C12:4F", cheat));
+    EXPECT_FALSE(cheat::decode("C123?A:4F", cheat));
+}
+
+TEST_F(CartridgeTest, Patch)
+{
+    uint8_t buffer;
+
+    auto card = CartridgeFactory::createCartridge(getRomBin(ROM_LOAD));
+    ASSERT_NE(card, nullptr);
+    card->attach(_mbus, _vbus);
+
+    // LDA #$1 to LDA #$42
+    card->patch({ genRomAddr(1), 0x42, 0x01, true });
+    _mbus.read(genRomAddr(0), buffer);
+    EXPECT_EQ(buffer, 0xa9);
+    _mbus.read(genRomAddr(1), buffer);
+    EXPECT_EQ(buffer, 0x42);
+
+    card->unpatch();
+    _mbus.read(genRomAddr(1), buffer);
+    EXPECT_EQ(buffer, 0x01);
 }
 
 int main(int argc, char **argv)
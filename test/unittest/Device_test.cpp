@@ -31,8 +31,8 @@ protected:
 
     Bus _bus;
     RandomAccessMemory _ram;
+    std::vector<uint8_t> _data; // before the ROM referring to it
     ReadOnlyMemory _rom;
-    std::vector<uint8_t> _data;
 };
 
 TEST_F(DeviceTest, RamReadWrite)
@@ -127,6 +127,146 @@ TEST_F(DeviceTest, RomReadWrite)
         _bus.read(addr, buffer);
         EXPECT_EQ(buffer, data);
     }
+
+    // Read from the device, before it is attached
+    ReadOnlyMemory rom(_data);
+    rom.read(ReadOnlyMemory::RomLowerBankBase + 0x1234, buffer);
+    EXPECT_EQ(buffer, 0x34);
+}
+
+TEST_F(DeviceTest, RomCheat)
+{
+    uint8_t buffer;
+
+    for (int i = 0; i < RomSize; ++i)
+        _data[i] = i & 0xff;
+
+    const uint8_t *origin = _bus.memory(0x8000);
+
+    _rom.patch({ 0x8123, 0x55, 0x00, false });
+    _rom.patch({ 0x8456, 0x66, 0x56, true });  // compare matches
+    _rom.patch({ 0x8457, 0x77, 0x00, true });  // compare mismatches
+
+    _bus.read(0x8123, buffer);
+    EXPECT_EQ(buffer, 0x55);
+    _bus.read(0x8456, buffer);
+    EXPECT_EQ(buffer, 0x66);
+    _bus.read(0x8457, buffer);
+    EXPECT_EQ(buffer, 0x57);
+
+    // The PRG data and the other pages are untouched
+    EXPECT_EQ(_data[0x0123], 0x23);
+    EXPECT_EQ(_bus.memory(0x8000), origin);
+    _bus.read(0x8124, buffer);
+    EXPECT_EQ(buffer, 0x24);
+
+    _rom.unpatch();
+    _bus.read(0x8123, buffer);
+    EXPECT_EQ(buffer, 0x23);
+    EXPECT_EQ(_bus.memory(0x8100), origin + 0x100);
+}
+
+TEST_F(DeviceTest, BusDump)
+{
+    std::array<uint8_t, AddressSpace> memory;
+
+    for (int i = 0; i < RomSize; ++i)
+        _data[i] = ~i & 0xff;
+
+    for (uint16_t i = 0; i < RandomAccessMemory::RamSize; ++i)
+        _bus.write(i, i & 0xff);
+
+    memory.fill(0x5a);
+    _bus.dump(0, memory.data(), ReadOnlyMemory::RomLowerBankBase);
+
+    // RAM and its mirrors
+    for (int i = 0; i < RandomAccessMemory::RamUpperBound; ++i)
+        ASSERT_EQ(memory[i], i & 0xff) << "Address " << i;
+
+    // Not mapped
+    for (int i = RandomAccessMemory::RamUpperBound; i < ReadOnlyMemory::RomLowerBankBase; ++i)
+        ASSERT_EQ(memory[i], 0x5a) << "Address " << i;
+
+    // ROM from an unaligned address
+    memory.fill(0x5a);
+    _bus.dump(ReadOnlyMemory::RomLowerBankBase + 1, memory.data(), RomSize - 1);
+    for (int i = 1; i < RomSize; ++i)
+        ASSERT_EQ(memory[i - 1], ~i & 0xff) << "Offset " << i;
+}
+
+TEST_F(DeviceTest, BusWatch)
+{
+    uint8_t buffer, watched = 0;
+    std::vector<std::pair<uint16_t, Access>> hits;
+    std::vector<uint8_t> values;
+
+    _bus.setWatcher([&] (uint16_t address, uint8_t data, Access access) {
+        hits.emplace_back(address, access);
+        values.push_back(data);
+    });
+
+    _bus.watch(0x0010, Access::Write);
+    _bus.watch(0x0812, Access::Read);
+
+    // Hit exactly, including mirrors of the watched address
+    _bus.write(0x0010, 0x01);
+    _bus.write(0x0011, 0x02);
+    _bus.read(0x0010, buffer);
+    _bus.read(0x0812, watched);
+    _bus.read(0x0012, buffer);
+    _bus.write(0x0812, 0x03);
+
+    // With the data written, or read
+    ASSERT_EQ(hits.size(), 2);
+    EXPECT_EQ(hits[0].first, 0x0010);
+    EXPECT_EQ(hits[0].second, Access::Write);
+    EXPECT_EQ(values[0], 0x01);
+    EXPECT_EQ(hits[1].first, 0x0812);
+    EXPECT_EQ(hits[1].second, Access::Read);
+    EXPECT_EQ(values[1], watched);
+
+    // Data still goes to the memory
+    _bus.read(0x0010, buffer);
+    EXPECT_EQ(buffer, 0x01);
+    _bus.read(0x0012, buffer);
+    EXPECT_EQ(buffer, 0x03);
+
+    hits.clear();
+    _bus.unwatch(0x0010, Access::Write);
+    _bus.write(0x0010, 0x04);
+    EXPECT_EQ(hits.size(), 0);
+
+    _bus.unwatch();
+    _bus.read(0x0812, buffer);
+    EXPECT_EQ(hits.size(), 0);
+}
+
+TEST_F(DeviceTest, BusOverlap)
+{
+    uint8_t buffer;
+    RandomAccessMemory ram;
+    ram.write(RandomAccessMemory::RamLowerBound, 0x00);
+
+    // The range of the RAM is already taken
+    ram.attach(_bus);
+
+    _bus.write(RandomAccessMemory::RamLowerBound, 0x5a);
+    _bus.read(RandomAccessMemory::RamLowerBound, buffer);
+    EXPECT_EQ(buffer, 0x5a);
+
+    ram.read(RandomAccessMemory::RamLowerBound, buffer);
+    EXPECT_EQ(buffer, 0x00);
+
+    // Mounted again once the range is free
+    _ram.detach();
+    ram.attach(_bus);
+
+    _bus.write(RandomAccessMemory::RamLowerBound, 0xa5);
+    ram.read(RandomAccessMemory::RamLowerBound, buffer);
+    EXPECT_EQ(buffer, 0xa5);
+
+    ram.detach();
+    _ram.attach(_bus);
 }
 
 int main(int argc, char **argv)
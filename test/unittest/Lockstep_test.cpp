@@ -0,0 +1,72 @@
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "Lockstep.h"
+
+#include "roms.h"
+#include "RomParser.hpp"
+
+using namespace tones;
+
+const int NesTestEntry = 0xc000;
+const int NesTestSteps = 5000; // unofficial instructions after 5004
+
+class LockstepTest : public ::testing::TestWithParam<cpu::Dispatch>
+{
+};
+
+TEST_P(LockstepTest, NesTest)
+{
+    cpu::Lockstep lockstep(cpu::Dispatch::Switch, GetParam());
+
+    ASSERT_TRUE(lockstep.insert(getRomBin("nestest")));
+
+    // Blocks run enough times are compiled, in the last passes
+    for (int pass = 0; pass <= jit::HotThreshold; ++pass) {
+        lockstep.reset();
+        lockstep.jump(NesTestEntry);
+
+        std::ostringstream report;
+        bool same = lockstep.run(NesTestSteps);
+        lockstep.report(report);
+        ASSERT_TRUE(same) << report.str();
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Cores,
+                         LockstepTest,
+                         testing::Values(
+                            cpu::Dispatch::Table,
+                            cpu::Dispatch::Fused,
+                            cpu::Dispatch::Cached,
+                            cpu::Dispatch::Block,
+                            cpu::Dispatch::Native
+                        ));
+
+TEST(LockstepDivergenceTest, Report)
+{
+    cpu::Lockstep lockstep(cpu::Dispatch::Switch, cpu::Dispatch::Fused);
+
+    ASSERT_TRUE(lockstep.insert(getRomBin("nestest")));
+    lockstep.jump(NesTestEntry);
+    ASSERT_TRUE(lockstep.run(100));
+
+    // Only one of them is interrupted
+    lockstep.candidate().nmi();
+    EXPECT_FALSE(lockstep.run(100));
+
+    const cpu::Lockstep::Divergence_t &divergence = lockstep.divergence();
+    EXPECT_EQ(divergence.instruction, 100);
+    EXPECT_NE(divergence.expected.PC, divergence.actual.PC);
+    EXPECT_EQ(divergence.actual.S + 3, divergence.expected.S);
+    EXPECT_EQ(divergence.actualWrites.size(), 3); // PC and P pushed
+
+    std::ostringstream report;
+    lockstep.report(report);
+    EXPECT_NE(report.str().find("Diverged at instruction 100"), std::string::npos) << report.str();
+
+    // Stays at the divergence
+    EXPECT_FALSE(lockstep.run(100));
+    EXPECT_EQ(lockstep.divergence().instruction, 100);
+}
@@ -12,7 +12,9 @@
 
 using namespace tones;
 
-class MicroProcessorTest : public ::testing::TestWithParam<std::string>
+//! A CPU on a bus with RAM, for the tests of each kind of parameter
+template <class Param>
+class CpuTest : public ::testing::TestWithParam<Param>
 {
 public:
 
@@ -20,7 +22,7 @@ public:
 
 public:
 
-    MicroProcessorTest() : _cpu(_mbus) {}
+    CpuTest() : _cpu(_mbus) {}
 
     void load_rom(const std::string &rom)
     {
@@ -31,28 +33,53 @@ public:
         _cpu.reset();
     }
 
+    void compare_registers(LogParser *parser, int num)
+    {
+        std::string info = hint(num, parser->line());
+
+        _cpu.dump(_regs);
+
+        ASSERT_EQ(_regs.PC, parser->regs().PC) << info;
+        ASSERT_EQ(_regs.A,  parser->regs().A)  << info;
+        ASSERT_EQ(_regs.X,  parser->regs().X)  << info;
+        ASSERT_EQ(_regs.Y,  parser->regs().Y)  << info;
+        ASSERT_EQ(_regs.S,  parser->regs().S)  << info;
+
+        // We don't care about the break bit and the undefined bit
+        ASSERT_EQ(_regs.P & StatusMask,  parser->regs().P & StatusMask) << info;
+    }
+
     void compare_step_by_step(LogParser *parser, int steps=0)
     {
         steps = !steps ? parser->size() : steps;
         ASSERT_NE(steps, 0);
 
         for (int i = 0; i < steps; ++i) {
-            std::string info = hint(i, parser->line());
+            ASSERT_NO_FATAL_FAILURE(compare_registers(parser, i));
 
-            _cpu.dump(_regs);
+            _cpu.step();
+            parser->next();
+        }
+    }
 
-            ASSERT_EQ(_regs.PC, parser->regs().PC) << info;
-            ASSERT_EQ(_regs.A,  parser->regs().A)  << info;
-            ASSERT_EQ(_regs.X,  parser->regs().X)  << info;
-            ASSERT_EQ(_regs.Y,  parser->regs().Y)  << info;
-            ASSERT_EQ(_regs.S,  parser->regs().S)  << info;
+    //! A step may run several instructions, compare where it stops only
+    int compare_block_by_block(LogParser *parser, int steps)
+    {
+        int blocks = 0;
 
-            // We don't care about the break bit and the undefined bit
-            ASSERT_EQ(_regs.P & StatusMask,  parser->regs().P & StatusMask) << info;
+        for (int i = 0; i < steps; ++blocks) {
+            compare_registers(parser, i);
+            if (this->HasFatalFailure())
+                break;
 
+            uint64_t retired = _cpu.instructions();
             _cpu.step();
-            parser->next();
+
+            for (; retired < _cpu.instructions(); ++retired, ++i)
+                parser->next();
         }
+
+        return blocks;
     }
 
     std::string hint(int num, const std::string &line)
@@ -76,6 +103,14 @@ protected:
     CartridgePtr _card;
 };
 
+class MicroProcessorTest : public CpuTest<std::string>
+{
+};
+
+class DispatchTest : public CpuTest<cpu::Dispatch>
+{
+};
+
 TEST_F(MicroProcessorTest, Reset)
 {
     std::string filepath = getRomBin(ROM_LOAD);
@@ -105,11 +140,91 @@ TEST_F(MicroProcessorTest, NMI)
     card->attach(_mbus, _vbus);
     _cpu.reset();
 
+    // Latched, and served before the next instruction
     _cpu.nmi();
     _cpu.dump(_regs);
+    EXPECT_TRUE(_cpu.pending());
+    EXPECT_EQ(_regs.PC, 0x8000);
 
+    _cpu.step();
+    _cpu.dump(_regs);
+
+    EXPECT_FALSE(_cpu.pending());
     EXPECT_EQ(_regs.S, 0xfa);
     EXPECT_EQ(_regs.PC, 0x8002);
+
+    // Only on the rising edge of the line
+    _cpu.setNmi(true);
+    _cpu.step(); // NOP of the handler
+    _cpu.setNmi(true);
+    EXPECT_FALSE(_cpu.pending());
+
+    _cpu.setNmi(false);
+    _cpu.setNmi(true);
+    EXPECT_TRUE(_cpu.pending());
+}
+
+TEST_F(MicroProcessorTest, IRQ)
+{
+    load_rom(ROM_INTERRUPT);
+
+    // Held, but disabled after reset
+    _cpu.setIrq(cpu::IrqSource::Mapper, true);
+    EXPECT_FALSE(_cpu.pending());
+
+    _cpu.step(); // BRK
+    _cpu.step(); // CLI
+    EXPECT_TRUE(_cpu.pending());
+
+    uint64_t instructions = _cpu.instructions();
+    _cpu.step();
+    _cpu.dump(_regs);
+
+    EXPECT_EQ(_cpu.instructions(), instructions); // in place of NOP
+    EXPECT_EQ(_regs.S, 0xf7);
+    EXPECT_EQ(_regs.PC, 0x8004);
+    EXPECT_FALSE(_cpu.pending()); // disabled in the handler
+
+    // The line is low only once all its sources are
+    _cpu.setIrq(cpu::IrqSource::APU, true);
+    _cpu.setIrq(cpu::IrqSource::Mapper, false);
+    _cpu.step(); // CLI
+    EXPECT_TRUE(_cpu.pending());
+
+    _cpu.setIrq(cpu::IrqSource::APU, false);
+    EXPECT_FALSE(_cpu.pending());
+}
+
+TEST_F(MicroProcessorTest, StackWatch)
+{
+    int hits = 0;
+    uint8_t data = 0;
+
+    load_rom(ROM_STACK);
+
+    // The stack skips the page table, but not the watchpoints
+    _mbus.setWatcher([&] (uint16_t, uint8_t value, Access) {
+        ++hits;
+        data = value;
+    });
+    _mbus.watch(0x01fd, Access::Write);
+
+    _cpu.step(); // LDA #$ff
+    _cpu.step(); // PHA
+    _cpu.step(); // PHP
+
+    EXPECT_EQ(hits, 1);
+    EXPECT_EQ(data, 0xff);
+
+    // Back to the host memory
+    _mbus.unwatch();
+    _cpu.step(); // LDA #$0
+    _cpu.step(); // PLP
+    _cpu.step(); // PLA
+    _cpu.dump(_regs);
+
+    EXPECT_EQ(hits, 1);
+    EXPECT_EQ(_regs.A, 0xff);
 }
 
 TEST_P(MicroProcessorTest, Instructions)
@@ -165,6 +280,355 @@ TEST_F(MicroProcessorTest, NesTest)
     compare_step_by_step(&parser, 5004); // unofficial instructions after 5004
 }
 
+TEST_P(DispatchTest, NesTest)
+{
+    std::string rom = "nestest";
+
+    cpu::Dispatch dispatch = GetParam();
+    bool blocks = dispatch == cpu::Dispatch::Block || dispatch == cpu::Dispatch::Native;
+
+    _cpu.setDispatch(dispatch);
+    load_rom(rom);
+
+    // Blocks run enough times are compiled, in the last passes
+    int passes = dispatch == cpu::Dispatch::Native ? jit::HotThreshold + 1 : 1;
+    for (int pass = 0; pass < passes; ++pass) {
+        NintendulatorLogParser parser;
+        parser.load(getRomLog(rom));
+
+        _cpu.reset();
+        _cpu.jump(0xc000);
+
+        if (!blocks) {
+            compare_step_by_step(&parser, 5004);
+            continue;
+        }
+
+        int count = compare_block_by_block(&parser, 5004);
+        ASSERT_FALSE(HasFatalFailure()) << "Pass " << pass;
+
+#ifndef TONES_BUS_TRACE
+        // Most steps run more than one instruction, unless the bus is traced
+        EXPECT_LT(count, 5004 / 2);
+#endif
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Cores,
+                         DispatchTest,
+                         testing::Values(
+                            cpu::Dispatch::Table,
+                            cpu::Dispatch::Switch,
+                            cpu::Dispatch::Fused,
+                            cpu::Dispatch::Cached,
+                            cpu::Dispatch::Block,
+                            cpu::Dispatch::Native
+                        ));
+
+TEST_F(MicroProcessorTest, SelfModifyingCode)
+{
+    // In RAM, the last iteration of the loop turns its NOP into INY
+    const uint8_t program[] = {
+        0xa2, 0x00,       // LDX #$00
+        0xa0, 0x00,       // LDY #$00
+        0xea,             // NOP, at $0304
+        0xa9, 0xc8,       // LDA #$c8, INY
+        0xe8,             // INX
+        0x9d, 0x05, 0x02, // STA $0205,X
+        0xd0, 0xf7,       // BNE $0304
+        0x4c, 0x0d, 0x03, // JMP $030d
+    };
+    for (int i = 0; i < (int)sizeof(program); ++i)
+        _mbus.write(0x0300 + i, program[i]);
+
+    _cpu.setDispatch(cpu::Dispatch::Native);
+    _cpu.jump(0x0300);
+
+    // The loop is compiled long before it writes to its own page
+    _cpu.dump(_regs);
+    while (_regs.PC != 0x030d) {
+        _cpu.step();
+        _cpu.dump(_regs);
+    }
+
+    EXPECT_EQ(_regs.X, 0);
+    EXPECT_EQ(_regs.Y, 1);
+}
+
+//! Column CYC of a line of the log of Nintendulator
+static uint64_t logCycles(const std::string &line)
+{
+    size_t at = line.find("CYC:");
+    return at == std::string::npos ? 0 : std::stoull(line.substr(at + 4));
+}
+
+TEST_F(MicroProcessorTest, NesTestCycleCounted)
+{
+    std::string rom = "nestest";
+
+    NintendulatorLogParser parser;
+    parser.load(getRomLog(rom));
+
+    load_rom(rom);
+    _cpu.jump(0xc000);
+
+    // With the cycles of page crossing and branches, as in the log
+    const uint64_t origin = _cpu.cycles() - logCycles(parser.line());
+    for (int i = 0; i < 5004; ++i) {
+        ASSERT_NO_FATAL_FAILURE(compare_registers(&parser, i));
+
+        cpu::State_t state;
+        _cpu.save(state);
+        ASSERT_EQ(state.cycles + state.skip - origin, logCycles(parser.line())) << hint(i, parser.line());
+
+        _cpu.step<accuracy::CycleCounted>();
+        parser.next();
+    }
+}
+
+TEST_F(MicroProcessorTest, DummyAccesses)
+{
+    // In RAM: LDX #$10; LDA $02f8,X; INC $0400
+    const uint8_t code[] = { 0xa2, 0x10, 0xbd, 0xf8, 0x02, 0xee, 0x00, 0x04 };
+    for (int i = 0; i < (int)sizeof(code); ++i)
+        _mbus.write(0x0300 + i, code[i]);
+    _mbus.write(0x0400, 0x41);
+
+    typedef std::pair<uint16_t, uint8_t> Hit;
+    std::vector<Hit> accesses;
+    _mbus.setWatcher([&] (uint16_t address, uint8_t data, Access) {
+        accesses.push_back({ address, data });
+    });
+    _mbus.watch(0x0208, Access::Read);  // before the carry into $0308
+    _mbus.watch(0x0400, Access::Write);
+
+    MicroProcessor::Registers_t regs;
+    for (bool counted : { false, true }) {
+        accesses.clear();
+        _cpu.jump(0x0300);
+        for (int i = 0; i < 3; ++i)
+            counted ? _cpu.step<accuracy::CycleCounted>() : _cpu.step<accuracy::Fast>();
+
+        _cpu.dump(regs);
+        EXPECT_EQ(regs.PC, 0x0308);
+
+        if (counted) {
+            // The unmodified byte is written back first
+            ASSERT_EQ(accesses.size(), 3);
+            EXPECT_EQ(accesses[0].first, 0x0208);
+            EXPECT_EQ(accesses[1], Hit(0x0400, 0x42));
+            EXPECT_EQ(accesses[2], Hit(0x0400, 0x43));
+        } else {
+            ASSERT_EQ(accesses.size(), 1);
+            EXPECT_EQ(accesses[0], Hit(0x0400, 0x42));
+        }
+    }
+}
+
+TEST_F(MicroProcessorTest, Profiler)
+{
+    cpu::Profiler profiler;
+
+    load_rom(ROM_IDIOMS);
+    _cpu.setProfiler(&profiler);
+
+    for (int i = 0; i < 200; ++i)
+        _cpu.step();
+
+    EXPECT_EQ(profiler.total(), 200);
+    EXPECT_EQ(profiler.count(0xbd, 0x9d), 16); // LDA ABS, X / STA ABS, X
+    EXPECT_EQ(profiler.count(0xca, 0xd0), 16); // DEX / BNE
+    EXPECT_EQ(profiler.count(0xc8, 0xc0), 8);  // INY / CPY #
+    EXPECT_EQ(profiler.count(0xa5, 0x8d), 1);  // LDA ZP / STA ABS
+
+    auto hottest = profiler.hottest(3);
+    ASSERT_EQ(hottest.size(), 3);
+    EXPECT_GE(hottest[0].count, hottest[1].count);
+    EXPECT_GE(hottest[1].count, hottest[2].count);
+}
+
+TEST_F(MicroProcessorTest, Superinstructions)
+{
+    Bus mbus, vbus;
+    RandomAccessMemory pram;
+    MicroProcessor fused(mbus);
+
+    auto card = CartridgeFactory::createCartridge(getRomBin(ROM_IDIOMS));
+    ASSERT_NE(card, nullptr);
+
+    pram.attach(mbus);
+    card->attach(mbus, vbus);
+    load_rom(ROM_IDIOMS);
+
+    // Blocks of the wait loop are compiled as well
+    for (auto dispatch : { cpu::Dispatch::Block, cpu::Dispatch::Native }) {
+        uint64_t fusedStart = fused.cycles();
+        uint64_t start = _cpu.cycles();
+
+        uint64_t retired = fused.instructions();
+        fused.setDispatch(dispatch);
+        fused.reset();
+        while (fused.instructions() - retired < 400)
+            fused.step();
+
+        uint64_t target = _cpu.instructions() + fused.instructions() - retired;
+        _cpu.reset();
+        while (_cpu.instructions() < target)
+            _cpu.step();
+
+        MicroProcessor::Registers_t regs;
+        fused.dump(regs);
+        _cpu.dump(_regs);
+
+        EXPECT_EQ(regs.PC, _regs.PC);
+        EXPECT_EQ(regs.A, _regs.A);
+        EXPECT_EQ(regs.X, _regs.X);
+        EXPECT_EQ(regs.Y, _regs.Y);
+        EXPECT_EQ(regs.S, _regs.S);
+        EXPECT_EQ(regs.P, _regs.P);
+
+        uint8_t expected[0x10], copied[0x10];
+        _mbus.dump(0x201, expected, sizeof(expected));
+        mbus.dump(0x201, copied, sizeof(copied));
+        EXPECT_EQ(0, memcmp(expected, copied, sizeof(expected)));
+
+        // Both start the next instruction at the same tick
+        fused.step();
+        _cpu.step();
+        EXPECT_EQ(fused.cycles() - fusedStart, _cpu.cycles() - start);
+    }
+}
+
+TEST_F(MicroProcessorTest, IdleLoop)
+{
+    const uint64_t Event = 5000; // tick to set the flag
+
+    Bus mbus, vbus;
+    RandomAccessMemory pram;
+    MicroProcessor idle(mbus);
+
+    auto card = CartridgeFactory::createCartridge(getRomBin(ROM_IDLE));
+    ASSERT_NE(card, nullptr);
+
+    pram.attach(mbus);
+    card->attach(mbus, vbus);
+    load_rom(ROM_IDLE);
+
+    idle.setDispatch(cpu::Dispatch::Block);
+    idle.setHorizon([&] () -> uint32_t {
+        return Event > idle.cycles() ? Event - idle.cycles() : 0;
+    });
+    idle.reset();
+
+    // Tick in step, the flag is set after the event
+    bool skipped = false;
+    while (_cpu.cycles() < Event) {
+        uint64_t instructions = idle.instructions();
+        idle.tick();
+        _cpu.tick();
+        skipped = skipped || idle.instructions() - instructions > 2;
+    }
+
+    // Blocks are off while the bus is traced
+#ifndef TONES_BUS_TRACE
+    EXPECT_TRUE(skipped);
+#endif
+
+    mbus.write(0x10, 1);
+    _mbus.write(0x10, 1);
+
+    // Leaves the loop at the same tick, with every iteration counted
+    _cpu.dump(_regs);
+    while (!_regs.X) {
+        _cpu.tick();
+        idle.tick();
+        _cpu.dump(_regs);
+    }
+
+    MicroProcessor::Registers_t regs;
+    idle.dump(regs);
+    EXPECT_EQ(regs.X, 1);
+#ifndef TONES_BUS_TRACE
+    EXPECT_EQ(idle.instructions(), _cpu.instructions() + 1); // JMP of the block
+#else
+    EXPECT_EQ(idle.instructions(), _cpu.instructions());
+#endif
+}
+
+TEST_F(MicroProcessorTest, Run)
+{
+    Bus mbus, vbus;
+    RandomAccessMemory pram;
+    MicroProcessor ticked(mbus);
+
+    auto card = CartridgeFactory::createCartridge(getRomBin("nestest"));
+    ASSERT_NE(card, nullptr);
+
+    pram.attach(mbus);
+    card->attach(mbus, vbus);
+    ticked.reset();
+    ticked.jump(0xc000);
+
+    load_rom("nestest");
+    _cpu.jump(0xc000);
+
+    // Budgets end at any tick of the instructions
+    for (uint32_t budget = 1; _cpu.instructions() < 5000; budget = budget % 13 + 1) {
+        uint16_t overshoot = _cpu.run(budget);
+        for (uint32_t i = 0; i < budget; ++i)
+            ticked.tick();
+
+        ASSERT_EQ(_cpu.cycles(), ticked.cycles());
+        ASSERT_EQ(_cpu.instructions(), ticked.instructions());
+
+        // Nothing is run until the last instruction is over
+        uint64_t instructions = _cpu.instructions();
+        ASSERT_EQ(_cpu.run(overshoot), 0);
+        ASSERT_EQ(_cpu.instructions(), instructions);
+        for (int i = 0; i < overshoot; ++i)
+            ticked.tick();
+
+        MicroProcessor::Registers_t regs;
+        ticked.dump(regs);
+        _cpu.dump(_regs);
+
+        ASSERT_EQ(regs.PC, _regs.PC);
+        ASSERT_EQ(regs.A, _regs.A);
+        ASSERT_EQ(regs.P, _regs.P);
+    }
+}
+
+TEST_F(MicroProcessorTest, SaveRestore)
+{
+    const int Saved = 1000; // line of the log
+
+    std::string rom = "nestest";
+
+    NintendulatorLogParser parser;
+    parser.load(getRomLog(rom));
+
+    load_rom(rom);
+    _cpu.jump(0xc000);
+
+    ASSERT_NO_FATAL_FAILURE(compare_step_by_step(&parser, Saved));
+
+    cpu::State_t state;
+    uint8_t ram[0x800];
+    _cpu.save(state);
+    _mbus.dump(0, ram, sizeof(ram));
+
+    for (int i = 0; i < 2000; ++i)
+        _cpu.step();
+
+    // Runs the rest of the log again from the saved state
+    for (int i = 0; i < (int)sizeof(ram); ++i)
+        _mbus.write(i, ram[i]);
+    _cpu.restore(state);
+
+    EXPECT_EQ(_cpu.cycles(), state.cycles);
+    compare_step_by_step(&parser, 5004 - Saved);
+}
+
 int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);
@@ -161,6 +161,40 @@ TEST_F(PictureProcessingUnitTest, MemoryMap)
     }
 }
 
+TEST_F(PictureProcessingUnitTest, Mirroring)
+{
+    uint8_t buff;
+    const uint16_t tables[] = { 0x2000, 0x2400, 0x2800, 0x2c00 };
+
+    // Expected source table of each table
+    const std::pair<Mirroring_t, std::array<int, 4>> modes[] = {
+        { Mirroring::Horizontal,  {{ 0, 0, 2, 2 }} },
+        { Mirroring::Vertical,    {{ 0, 1, 0, 1 }} },
+        { Mirroring::SingleLower, {{ 0, 0, 0, 0 }} },
+        { Mirroring::SingleUpper, {{ 1, 1, 1, 1 }} },
+        { Mirroring::FourScreen,  {{ 0, 1, 2, 3 }} },
+    };
+
+    for (auto &mode : modes) {
+        _vram.setMirroring(mode.first);
+
+        for (int n = 0; n < 4; ++n) {
+            if (mode.second[n] == n)
+                _vbus.write(tables[n] + n, n);
+        }
+
+        for (int n = 0; n < 4; ++n) {
+            int src = mode.second[n];
+            _vbus.read(tables[n] + src, buff);
+            EXPECT_EQ(buff, src) << "Table " << n;
+
+            // Mirrors of $2000-$2EFF
+            _vbus.read((tables[n] + src) | 0x1000, buff);
+            EXPECT_EQ(buff, src) << "Table " << n;
+        }
+    }
+}
+
 TEST_F(PictureProcessingUnitTest, OamReadWrite)
 {
     uint8_t buff;
@@ -196,6 +230,26 @@ TEST_F(PictureProcessingUnitTest, OamDma)
     }
 }
 
+TEST_F(PictureProcessingUnitTest, OamDmaWrap)
+{
+    uint8_t buff = 0;
+
+    // Initialize page 2
+    for (uint16_t addr = 0x0200; addr < 0x0300; ++addr) {
+        _mbus.write(addr, buff++);
+    }
+
+    // Copied from OAMADDR and wraps around
+    _mbus.write(ppu::OAMADDR, 0x10);
+    _mbus.write(OAMDMA, 0x02);
+
+    for (int addr = 0; addr < ppu::SpriteMemorySize; ++addr) {
+        _mbus.write(ppu::OAMADDR, addr);
+        _mbus.read(ppu::OAMDATA, buff);
+        ASSERT_EQ((addr - 0x10) & 0xff, buff);
+    }
+}
+
 TEST_F(PictureProcessingUnitTest, VRamAddress)
 {
     const uint16_t base = VideoRandomAccessMemory::VramLowerBound;
@@ -399,6 +453,56 @@ TEST_F(PictureProcessingUnitTest, ReadStatus)
     EXPECT_FALSE(buff & 0x80) << "PPUSTATUS: " << (int)buff;
 }
 
+TEST_F(PictureProcessingUnitTest, PeekStatus)
+{
+    const int size = (ppu::NTSC.lineEnd) * (ppu::NTSC.dotEnd + 1);
+
+    for (int i = 0; i < size; ++i) {
+        _ppu.tick();
+    }
+
+    _mbus.write(ppu::PPUSCROLL, 0x7d);
+
+    // Peeking neither clears the vblank bit nor resets W
+    uint8_t buff;
+    _mbus.peek(ppu::PPUSTATUS, buff);
+    EXPECT_TRUE(buff & 0x80) << "PPUSTATUS: " << (int)buff;
+    _mbus.peek(ppu::PPUSTATUS, buff);
+    EXPECT_TRUE(buff & 0x80) << "PPUSTATUS: " << (int)buff;
+
+    _ppu.dump(_regs);
+    EXPECT_EQ(_regs.W, 0x01);
+
+    _mbus.read(ppu::PPUSTATUS, buff);
+    EXPECT_TRUE(buff & 0x80) << "PPUSTATUS: " << (int)buff;
+}
+
+TEST_F(PictureProcessingUnitTest, QuietDots)
+{
+    uint8_t buff;
+
+    _mbus.read(ppu::PPUSTATUS, buff);
+    _mbus.write(ppu::PPUCTRL, 0x80); // NMI enabled
+
+    // Nothing changes in the quiet dots
+    uint32_t quiet = _ppu.quietDots();
+    for (uint32_t i = 0; i < quiet; ++i)
+        _ppu.tick();
+
+    _mbus.peek(ppu::PPUSTATUS, buff);
+    EXPECT_EQ(buff & 0x80, 0x00);
+    EXPECT_EQ(_count, 0);
+
+    // The vblank starts right after, at most one dot later
+    _ppu.tick();
+    _ppu.tick();
+
+    _mbus.peek(ppu::PPUSTATUS, buff);
+    EXPECT_EQ(buff & 0x80, 0x80);
+    EXPECT_EQ(_count, 1);
+    EXPECT_LE(_ppu.quietDots(), 89342);
+}
+
 TEST_F(PictureProcessingUnitTest, RenderDisabledWrite)
 {
     uint8_t addr;
@@ -422,6 +526,52 @@ TEST_F(PictureProcessingUnitTest, RenderDisabledWrite)
     }
 }
 
+TEST_F(PictureProcessingUnitTest, RunFast)
+{
+    // The same PPU, run dot by dot
+    Bus mbus, vbus;
+    VideoRandomAccessMemory vram;
+    PictureProcessingUnit slow(vbus, mbus);
+    int count = 0;
+
+    vram.attach(vbus);
+    slow.reset();
+    slow.setBlankHandler([&] () { ++count; });
+
+    const uint32_t chunks[] = { 1, 3, 7, 113, 341, 1000, 5000 };
+    for (int frame = 0; frame < 6; ++frame) {
+        // Rendering in every other frame, which skips a dot if odd
+        uint8_t mask = frame % 2 ? 0x18 : 0x00;
+        _mbus.write(ppu::PPUMASK, mask);
+        mbus.write(ppu::PPUMASK, mask);
+        _mbus.write(ppu::PPUCTRL, 0x80);
+        mbus.write(ppu::PPUCTRL, 0x80);
+
+        for (uint32_t dots = 0, i = 0; dots < 89342; ++i) {
+            uint32_t chunk = chunks[i % 7];
+            _ppu.run<accuracy::Fast>(chunk);
+            slow.run<accuracy::CycleCounted>(chunk);
+            dots += chunk;
+
+            ASSERT_EQ(_ppu.quietDots(), slow.quietDots()) << "frame " << frame << " dot " << dots;
+            ASSERT_EQ(_count, count);
+        }
+
+        PictureProcessingUnit::Registers_t regs;
+        _ppu.dump(_regs);
+        slow.dump(regs);
+        EXPECT_EQ(_regs.V, regs.V);
+        EXPECT_EQ(_regs.T, regs.T);
+
+        uint8_t status, expected;
+        _mbus.peek(ppu::PPUSTATUS, status);
+        mbus.peek(ppu::PPUSTATUS, expected);
+        EXPECT_EQ(status, expected);
+    }
+
+    EXPECT_GE(_count, 5);
+}
+
 int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+
+#include "Clock.h"
+#include "System.h"
+
+#include "roms.h"
+
+using namespace tones;
+
+/* Wired as MotherBoard, with the runtime Clock */
+class Reference
+{
+
+public:
+
+    Reference()
+        : _cpu(_mbus)
+        , _ppu(_vbus, _mbus)
+        , _odma(OAMDMA, ppu::OAMDATA, ppu::SpriteMemorySize)
+    {
+        _pram.attach(_mbus);
+        _sram.attach(_mbus);
+        _vram.attach(_vbus);
+
+        _odma.attach(_mbus);
+        _odma.setHandler([this] () { _cpu.wait(513); });
+
+        _cpu.attach(_clock, board::NROM::CpuTicks);
+        _ppu.attach(_clock, board::NROM::PpuTicks);
+
+        _ppu.setBlankHandler([this] () { _cpu.nmi(); });
+    }
+
+    void insert(CartridgePtr &card)
+    {
+        card->attach(_mbus, _vbus);
+        _vram.setMirroring(card->mirroring());
+        _cpu.reset();
+        _ppu.reset();
+    }
+
+    Bus _mbus, _vbus;
+    Clock _clock;
+
+    MicroProcessor _cpu;
+    PictureProcessingUnit _ppu;
+
+    RandomAccessMemory _pram;
+    VideoRandomAccessMemory _vram;
+    SaveRandomAccessMemory _sram;
+    DirectMemoryAccess _odma;
+};
+
+TEST(SystemTest, Insert)
+{
+    NromSystem system;
+    CartridgePtr none;
+
+    EXPECT_FALSE(system.insert(none));
+
+    auto card = CartridgeFactory::createCartridge(getRomBin("nestest"));
+    ASSERT_TRUE(card);
+    EXPECT_TRUE(system.insert(card));
+}
+
+TEST(SystemTest, SameAsClock)
+{
+    const int frames = 10;
+
+    NromSystem system;
+    Reference reference;
+
+    auto card1 = CartridgeFactory::createCartridge(getRomBin("nestest"));
+    auto card2 = CartridgeFactory::createCartridge(getRomBin("nestest"));
+    ASSERT_TRUE(card1 && card2);
+
+    ASSERT_TRUE(system.insert(card1));
+    reference.insert(card2);
+
+    int count1 = 0, count2 = 0;
+    system.setFrameEnd([&] () { ++count1; });
+    reference._ppu.setFrameEnd([&] () { ++count2; });
+
+    MicroProcessor::Registers_t cpu1, cpu2;
+    PictureProcessingUnit::Registers_t ppu1, ppu2;
+
+    for (int f = 0; f < frames; ++f) {
+        system.frame();
+        for (uint32_t i = 0; i < board::NROM::Frequency; ++i)
+            reference._clock.tick();
+
+        system.dumpCpuRegisters(cpu1);
+        reference._cpu.dump(cpu2);
+        EXPECT_EQ(cpu1.PC, cpu2.PC);
+        EXPECT_EQ(cpu1.A, cpu2.A);
+        EXPECT_EQ(cpu1.S, cpu2.S);
+        EXPECT_EQ(cpu1.P, cpu2.P);
+
+        system.dumpPpuRegisters(ppu1);
+        reference._ppu.dump(ppu2);
+        EXPECT_EQ(ppu1.V, ppu2.V);
+        EXPECT_EQ(ppu1.CTRL, ppu2.CTRL);
+    }
+
+    EXPECT_EQ(count1, count2);
+    EXPECT_GT(count1, 0);
+}
+
+TEST(SystemTest, CycleCounted)
+{
+    const int frames = 10;
+
+    NromSystem fast;
+    CycleCountedNromSystem counted;
+
+    auto card1 = CartridgeFactory::createCartridge(getRomBin("nestest"));
+    auto card2 = CartridgeFactory::createCartridge(getRomBin("nestest"));
+    ASSERT_TRUE(card1 && card2);
+
+    ASSERT_TRUE(fast.insert(card1));
+    ASSERT_TRUE(counted.insert(card2));
+
+    int count1 = 0, count2 = 0;
+    fast.setFrameEnd([&] () { ++count1; });
+    counted.setFrameEnd([&] () { ++count2; });
+
+    for (int f = 0; f < frames; ++f) {
+        fast.frame();
+        counted.frame();
+    }
+
+    // Only the timing of the CPU differs, the frames do not
+    EXPECT_EQ(count1, count2);
+    EXPECT_GT(count2, 0);
+
+    MicroProcessor::Registers_t regs;
+    counted.dumpCpuRegisters(regs);
+    EXPECT_TRUE(regs.PC >= ReadOnlyMemory::RomLowerBankBase);
+}
+
+TEST(SystemTest, CatchUp)
+{
+    const uint32_t chunks[] = { 1, 7, 114, 1000, 29781 };
+
+    Reference clocked, caught;
+    CatchUp catchUp(caught._cpu, caught._ppu, board::NROM::PpuTicks);
+
+    int syncs = 0;
+    caught._ppu.setSync([&] () {
+        ++syncs;
+        catchUp.sync();
+    });
+
+    auto card1 = CartridgeFactory::createCartridge(getRomBin("nestest"));
+    auto card2 = CartridgeFactory::createCartridge(getRomBin("nestest"));
+    ASSERT_TRUE(card1 && card2);
+
+    // The same RAM, which the game reads before writing it
+    for (Reference *reference : { &clocked, &caught }) {
+        for (int address = 0; address < RandomAccessMemory::RamSize; ++address)
+            reference->_mbus.write(address, 0);
+    }
+
+    clocked.insert(card1);
+    caught.insert(card2);
+    catchUp.reset();
+
+    MicroProcessor::Registers_t cpu1, cpu2;
+    PictureProcessingUnit::Registers_t ppu1, ppu2;
+
+    for (int i = 0; i < 50; ++i) {
+        uint32_t ticks = chunks[i % 5];
+        for (uint32_t t = 0; t < ticks; ++t)
+            clocked._clock.tick();
+        catchUp.run(ticks);
+
+        ASSERT_EQ(caught._cpu.cycles(), clocked._cpu.cycles());
+        ASSERT_EQ(caught._ppu.quietDots(), clocked._ppu.quietDots()) << "chunk " << i;
+
+        clocked._cpu.dump(cpu1);
+        caught._cpu.dump(cpu2);
+        ASSERT_EQ(cpu1.PC, cpu2.PC) << "chunk " << i;
+        ASSERT_EQ(cpu1.A, cpu2.A) << "chunk " << i;
+        ASSERT_EQ(cpu1.P, cpu2.P) << "chunk " << i;
+
+        clocked._ppu.dump(ppu1);
+        caught._ppu.dump(ppu2);
+        ASSERT_EQ(ppu1.V, ppu2.V) << "chunk " << i;
+        ASSERT_EQ(ppu1.CTRL, ppu2.CTRL) << "chunk " << i;
+        ASSERT_EQ(ppu1.MASK, ppu2.MASK) << "chunk " << i;
+    }
+
+    // Caught up by the accesses to its registers in between
+    EXPECT_GT(syncs, 0);
+}
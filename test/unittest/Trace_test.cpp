@@ -0,0 +1,128 @@
+#include <cstdio>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Device.h"
+#include "MotherBoard.h"
+#include "Trace.h"
+
+using namespace tones;
+
+TEST(TraceTest, RingBuffer)
+{
+    uint64_t cycles = 0;
+    trace::RingBuffer buffer(6); // rounded up to 8
+    trace::Record_t records[16];
+
+    buffer.setClock(&cycles);
+
+    for (int i = 0; i < 10; ++i) {
+        cycles = 100 + i;
+        buffer.record(trace::CpuBus, 0x0200 + i, i, static_cast<uint8_t>(Access::Write));
+    }
+
+    // Records beyond the capacity are dropped
+    EXPECT_EQ(buffer.dropped(), 2);
+    ASSERT_EQ(buffer.drain(records, 16), 8);
+
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_EQ(records[i].cycle, 100 + i);
+        EXPECT_EQ(records[i].address, 0x0200 + i);
+        EXPECT_EQ(records[i].data, i);
+        EXPECT_EQ(records[i].access, static_cast<uint8_t>(Access::Write));
+        EXPECT_EQ(records[i].bus, trace::CpuBus);
+    }
+
+    // Room again after draining
+    buffer.record(trace::PpuBus, 0x2000, 0x55, static_cast<uint8_t>(Access::Read));
+    ASSERT_EQ(buffer.drain(records, 16), 1);
+    EXPECT_EQ(records[0].address, 0x2000);
+    EXPECT_EQ(records[0].bus, trace::PpuBus);
+    EXPECT_EQ(buffer.drain(records, 16), 0);
+}
+
+TEST(TraceTest, Writer)
+{
+    const char *path = "trace_test.bin";
+    const int count = 5000;
+
+    trace::RingBuffer buffer;
+    trace::Writer writer(buffer);
+
+    ASSERT_TRUE(writer.open(path));
+    for (int i = 0; i < count; ++i)
+        buffer.record(trace::CpuBus, i, i, static_cast<uint8_t>(Access::Read));
+    writer.close();
+
+    std::vector<trace::Record_t> records(count + 1);
+    std::FILE *file = std::fopen(path, "rb");
+    ASSERT_NE(file, nullptr);
+    EXPECT_EQ(std::fread(records.data(), sizeof(trace::Record_t), count + 1, file), count);
+    std::fclose(file);
+    std::remove(path);
+
+    for (int i = 0; i < count; ++i)
+        EXPECT_EQ(records[i].address, i);
+}
+
+#ifdef TONES_BUS_TRACE
+TEST(TraceTest, Bus)
+{
+    Bus bus;
+    RandomAccessMemory ram;
+    trace::RingBuffer buffer;
+    trace::Record_t records[4];
+    uint8_t data;
+
+    ram.attach(bus);
+    bus.setTracer(&buffer, trace::PpuBus);
+
+    bus.write(0x0010, 0x42);
+    bus.read(0x0810, data);
+
+    bus.setTracer(nullptr, trace::PpuBus);
+    bus.read(0x0010, data);
+
+    ASSERT_EQ(buffer.drain(records, 4), 2);
+    EXPECT_EQ(records[0].access, static_cast<uint8_t>(Access::Write));
+    EXPECT_EQ(records[1].address, 0x0810);
+    EXPECT_EQ(records[1].data, 0x42);
+    EXPECT_EQ(records[1].access, static_cast<uint8_t>(Access::Read));
+    EXPECT_EQ(records[1].bus, trace::PpuBus);
+}
+
+TEST(TraceTest, DirectMemoryAccess)
+{
+    const int length = 4;
+
+    Bus bus;
+    RandomAccessMemory ram;
+    DirectMemoryAccess dma(OAMDMA, 0x0700, length);
+    trace::RingBuffer buffer;
+    trace::Record_t records[16];
+
+    ram.attach(bus);
+    dma.attach(bus);
+
+    for (int i = 0; i < length; ++i)
+        bus.write(0x0200 + i, 0x10 + i);
+
+    // Each byte read from the source, as copied byte by byte
+    bus.setTracer(&buffer, trace::CpuBus);
+    bus.write(OAMDMA, 0x02);
+
+    // Then the write starting it, recorded once done
+    ASSERT_EQ(buffer.drain(records, 16), 2 * length + 1);
+    EXPECT_EQ(records[2 * length].address, OAMDMA);
+    for (int i = 0; i < length; ++i) {
+        const trace::Record_t &read = records[2 * i], &write = records[2 * i + 1];
+        EXPECT_EQ(read.address, 0x0200 + i);
+        EXPECT_EQ(read.data, 0x10 + i);
+        EXPECT_EQ(read.access, static_cast<uint8_t>(Access::Read));
+        EXPECT_EQ(write.address, 0x0700);
+        EXPECT_EQ(write.data, 0x10 + i);
+        EXPECT_EQ(write.access, static_cast<uint8_t>(Access::Write));
+    }
+}
+#endif